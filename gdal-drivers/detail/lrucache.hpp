@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef gdal_drivers_detail_lrucache_hpp_included_
+#define gdal_drivers_detail_lrucache_hpp_included_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace gdal_drivers { namespace detail {
+
+/** Thread-safe size-bounded LRU cache of shared immutable values.
+ *
+ *  Every entry is charged by its size in bytes; least recently used entries
+ *  are evicted once total size exceeds budget. Evicted values stay alive as
+ *  long as somebody holds them. Zero budget disables caching.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    typedef std::shared_ptr<const Value> Pointer;
+
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::size_t size;
+        std::size_t budget;
+
+        Stats() : hits(), misses(), size(), budget() {}
+    };
+
+    explicit LruCache(std::size_t budget) : size_(), budget_(budget) {}
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    /** Returns cached value or null pointer. Counts hit or miss.
+     */
+    Pointer get(const Key &key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fentries(index_.find(key));
+        if (fentries == index_.end()) {
+            ++stats_.misses;
+            return {};
+        }
+
+        ++stats_.hits;
+        // move to front
+        entries_.splice(entries_.begin(), entries_, fentries->second);
+        return fentries->second->value;
+    }
+
+    /** Inserts (or replaces) value.
+     */
+    void put(const Key &key, const Pointer &value, std::size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size > budget_) { return; }
+
+        auto fentries(index_.find(key));
+        if (fentries != index_.end()) {
+            size_ -= fentries->second->size;
+            entries_.erase(fentries->second);
+            index_.erase(fentries);
+        }
+
+        entries_.push_front(Entry{ key, value, size });
+        index_.emplace(key, entries_.begin());
+        size_ += size;
+        shrink();
+    }
+
+    /** Removes all entries with key matching predicate. Returns number of
+     *  removed entries.
+     */
+    template <typename Predicate>
+    std::size_t erase(Predicate predicate) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::size_t removed(0);
+        for (auto ientries(entries_.begin()); ientries != entries_.end(); ) {
+            if (!predicate(ientries->key)) { ++ientries; continue; }
+            size_ -= ientries->size;
+            index_.erase(ientries->key);
+            ientries = entries_.erase(ientries);
+            ++removed;
+        }
+        return removed;
+    }
+
+    /** Sets new budget, evicts entries if needed.
+     */
+    void budget(std::size_t budget) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = budget;
+        shrink();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats stats(stats_);
+        stats.size = size_;
+        stats.budget = budget_;
+        return stats;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Pointer value;
+        std::size_t size;
+    };
+
+    typedef std::list<Entry> Entries;
+
+    void shrink() {
+        while (size_ > budget_) {
+            const auto &last(entries_.back());
+            size_ -= last.size;
+            index_.erase(last.key);
+            entries_.pop_back();
+        }
+    }
+
+    mutable std::mutex mutex_;
+    Entries entries_;
+    std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+    std::size_t size_;
+    std::size_t budget_;
+    Stats stats_;
+};
+
+} } // namespace gdal_drivers::detail
+
+#endif // gdal_drivers_detail_lrucache_hpp_included_
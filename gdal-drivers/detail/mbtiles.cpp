@@ -24,22 +24,33 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdio>
 #include <cstring>
-
-#include <boost/iostreams/stream_buffer.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <set>
+#include <thread>
+#include <mutex>
 
 #include <sqlite3.h>
+#include <zlib.h>
 
 #include <cpl_error.h>
+#include <cpl_string.h>
+#include <cpl_conv.h>
+#include <cpl_vsi.h>
 
 #include "dbglog/dbglog.hpp"
 
 #include "vector_tile.pb.h"
 #include "mbtiles.hpp"
-
-namespace bio = boost::iostreams;
+#include "prefetcher.hpp"
+#include "lrucache.hpp"
+#include "tilepresence.hpp"
 
 namespace gdal_drivers { namespace detail {
 
@@ -60,6 +71,467 @@ struct Statement {
     ::sqlite3_stmt *stmt;
 };
 
+bool check(int status, Database &db, const char *what);
+
+/** Per-archive read tuning, see configureMbTilesArchive.
+ */
+class ReadOptionsRegistry {
+public:
+    /** Sets options, returns previous ones.
+     */
+    MbTilesReadOptions exchange(const std::string &archive
+                                , const MbTilesReadOptions &options)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &current(options_[archive]);
+        const auto previous(current);
+        current = options;
+        return previous;
+    }
+
+    MbTilesReadOptions get(const std::string &archive) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto foptions(options_.find(archive));
+        if (foptions == options_.end()) { return {}; }
+        return foptions->second;
+    }
+
+    static ReadOptionsRegistry& instance() {
+        static ReadOptionsRegistry registry;
+        return registry;
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, MbTilesReadOptions> options_;
+};
+
+/** Builds SQLite URI for given path. Only characters with special meaning
+ *  in URIs are escaped.
+ */
+std::string fileUri(const std::string &path, const MbTilesReadOptions &options)
+{
+    std::string uri("file:");
+    for (char c : path) {
+        switch (c) {
+        case '?': uri += "%3f"; break;
+        case '#': uri += "%23"; break;
+        case '%': uri += "%25"; break;
+        default: uri.push_back(c);
+        }
+    }
+
+    const char *sep("?");
+    if (options.immutable) { uri += sep; uri += "immutable=1"; sep = "&"; }
+    if (options.noLock) { uri += sep; uri += "nolock=1"; }
+    return uri;
+}
+
+/** Opens archive read-only, honoring configured read options.
+ */
+bool openReadOnly(Database &db, bool noMutex)
+{
+    const auto options(ReadOptionsRegistry::instance().get(db.path));
+
+    int flags(SQLITE_OPEN_READONLY);
+    if (noMutex) { flags |= SQLITE_OPEN_NOMUTEX; }
+
+    if (options.immutable || options.noLock) {
+        flags |= SQLITE_OPEN_URI;
+        if (check(::sqlite3_open_v2(fileUri(db.path, options).c_str()
+                                    , &db.db, flags, nullptr)
+                  , db, "sqlite3_open_v2"))  { return false; }
+    } else if (check(::sqlite3_open_v2(db.path.c_str(), &db.db, flags
+                                       , nullptr)
+                     , db, "sqlite3_open_v2"))
+    {
+        return false;
+    }
+
+    if (options.mmapSize >= 0) {
+        const auto sql("PRAGMA mmap_size=" + std::to_string(options.mmapSize));
+        if (check(::sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr)
+                  , db, "sqlite3_exec")) { return false; }
+    }
+
+    if (options.cacheSize >= 0) {
+        // negative cache_size is in KiB
+        const auto sql("PRAGMA cache_size=-"
+                       + std::to_string(options.cacheSize / 1024));
+        if (check(::sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr)
+                  , db, "sqlite3_exec")) { return false; }
+    }
+
+    return true;
+}
+
+/** Detects deduplicated schema: tiles view over map and images tables.
+ */
+bool detectDeduplicated(Database &db, bool &deduplicated)
+{
+    Statement stmt;
+    if (check(::sqlite3_prepare_v2(db, ("SELECT COUNT(*) FROM sqlite_master"
+                                        " WHERE type='table'"
+                                        "     AND name IN ('map', 'images')")
+                                   , -1 // read until \0
+                                   , &stmt.stmt, nullptr)
+              , db, "sqlite3_prepare_v2")) { return false; }
+
+    const auto res(::sqlite3_step(stmt));
+    if (res != SQLITE_ROW) {
+        check(res, db, "sqlite3_step");
+        return false;
+    }
+
+    deduplicated = (::sqlite3_column_int(stmt, 0) == 2);
+    return true;
+}
+
+/** Single tile query. Column 0 is tile_id (NULL if archive is not
+ *  deduplicated), column 1 is tile data.
+ */
+const char* selectTileSql(bool deduplicated)
+{
+    // deduplicated archives are joined directly, tiles view is slower
+    return (deduplicated
+            ? ("SELECT map.tile_id, images.tile_data"
+               " FROM map JOIN images ON images.tile_id = map.tile_id"
+               " WHERE map.zoom_level=? AND map.tile_column=?"
+               "     AND map.tile_row=?")
+            : ("SELECT NULL, tile_data "
+               "FROM tiles WHERE zoom_level=?"
+               "     AND tile_column=?"
+               "     AND tile_row=?"));
+}
+
+/** Tile range query. Columns: tile_column, tile_row, tile_data, tile_id
+ *  (NULL if archive is not deduplicated).
+ */
+std::string selectRangeSql(bool deduplicated, bool rowMajor)
+{
+    std::string sql
+        (deduplicated
+         ? ("SELECT map.tile_column, map.tile_row, images.tile_data"
+            ", map.tile_id"
+            " FROM map JOIN images ON images.tile_id = map.tile_id"
+            " WHERE map.zoom_level=? AND map.tile_column BETWEEN ? AND ?"
+            "     AND map.tile_row BETWEEN ? AND ?")
+         : ("SELECT tile_column, tile_row, tile_data, NULL FROM tiles"
+            " WHERE zoom_level=? AND tile_column BETWEEN ? AND ?"
+            "     AND tile_row BETWEEN ? AND ?"));
+
+    // index order is the fastest one, row by row must be sorted
+    const char *prefix(deduplicated ? "map." : "");
+    sql += " ORDER BY ";
+    if (rowMajor) {
+        sql += prefix; sql += "tile_row DESC, ";
+        sql += prefix; sql += "tile_column";
+    } else {
+        sql += prefix; sql += "tile_column, ";
+        sql += prefix; sql += "tile_row";
+    }
+    return sql;
+}
+
+/** Returns text column as string, empty string for NULL.
+ */
+std::string textColumn(::sqlite3_stmt *stmt, int column)
+{
+    const auto *text(::sqlite3_column_text(stmt, column));
+    if (!text) { return {}; }
+    return std::string(reinterpret_cast<const char*>(text)
+                       , ::sqlite3_column_bytes(stmt, column));
+}
+
+/** Open read-only connection with its prepared statements. Used by single
+ *  thread at a time.
+ */
+struct Connection {
+    Connection(const std::string &path) : db(path) {}
+
+    /** Opens database and prepares statements. Returns false on failure.
+     */
+    bool open();
+
+    Database db;
+    Statement selectTile;
+
+    typedef std::unique_ptr<Connection> pointer;
+};
+
+bool Connection::open()
+{
+    // connection is never shared between threads at the same time
+    if (!openReadOnly(db, true)) { return false; }
+
+    bool deduplicated(false);
+    if (!detectDeduplicated(db, deduplicated)) { return false; }
+
+    if (check(::sqlite3_prepare_v2(db, selectTileSql(deduplicated)
+                                   , -1 // read until \0
+                                   , &selectTile.stmt
+                                   , nullptr)
+              , db, "sqlite3_prepare_v2")) { return false; }
+
+    return true;
+}
+
+/** Process-wide pool of idle read-only connections keyed by archive path.
+ */
+class ConnectionPool {
+public:
+    /** Borrows idle connection or opens new one. Returns null pointer on
+     *  failure (CPLError is set).
+     */
+    Connection::pointer acquire(const std::string &path);
+
+    /** Returns connection to the pool.
+     */
+    void release(Connection::pointer conn);
+
+    /** Closes all idle connections to given archive.
+     */
+    void drop(const std::string &path);
+
+    static ConnectionPool& instance() {
+        static ConnectionPool pool;
+        return pool;
+    }
+
+private:
+    /** Maximum number of idle connections kept per archive.
+     */
+    static constexpr std::size_t maxIdle = 16;
+
+    std::mutex mutex_;
+    std::map<std::string, std::vector<Connection::pointer>> idle_;
+};
+
+void ConnectionPool::drop(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.erase(path);
+}
+
+Connection::pointer ConnectionPool::acquire(const std::string &path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fidle(idle_.find(path));
+        if ((fidle != idle_.end()) && !fidle->second.empty()) {
+            auto conn(std::move(fidle->second.back()));
+            fidle->second.pop_back();
+            return conn;
+        }
+    }
+
+    // open outside of lock
+    Connection::pointer conn(new Connection(path));
+    if (!conn->open()) { return {}; }
+    return conn;
+}
+
+void ConnectionPool::release(Connection::pointer conn)
+{
+    // make statement ready for next use, drops any read lock
+    ::sqlite3_reset(conn->selectTile);
+    ::sqlite3_clear_bindings(conn->selectTile);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &idle(idle_[conn->db.path]);
+    if (idle.size() < maxIdle) { idle.push_back(std::move(conn)); }
+}
+
+/** Borrowed connection, returned to the pool on destruction.
+ */
+struct Lease {
+    Lease(const std::string &path)
+        : conn(ConnectionPool::instance().acquire(path))
+    {}
+
+    ~Lease() {
+        if (conn) { ConnectionPool::instance().release(std::move(conn)); }
+    }
+
+    Connection::pointer conn;
+};
+
+/** Identifies current version of archive file.
+ */
+TilePresence::Stamp archiveStamp(const std::string &archive)
+{
+    TilePresence::Stamp stamp;
+    ::VSIStatBufL st;
+    if (!::VSIStatL(archive.c_str(), &st)) {
+        stamp.size = st.st_size;
+        stamp.mtime = st.st_mtime;
+    }
+    return stamp;
+}
+
+/** Builds index of all tiles in archive. Persisted index is used (and
+ *  updated) when sidecar file is configured.
+ */
+TilePresence::pointer buildTilePresence(const std::string &archive
+                                        , const MbTilesReadOptions &options
+                                        , const TilePresence::Stamp &stamp)
+{
+    if (!options.tileIndexFile.empty()) {
+        if (auto presence = TilePresence::load(options.tileIndexFile, stamp))
+        {
+            LOG(info1) << "Loaded index of " << presence->count()
+                       << " tiles of <" << archive << "> from <"
+                       << options.tileIndexFile << ">.";
+            return TilePresence::pointer(std::move(presence));
+        }
+    }
+
+    Database db(archive);
+    if (!openReadOnly(db, false)) { return {}; }
+
+    bool deduplicated(false);
+    if (!detectDeduplicated(db, deduplicated)) { return {}; }
+
+    Statement stmt;
+    if (check(::sqlite3_prepare_v2(db, (deduplicated
+                                        ? ("SELECT zoom_level, tile_column"
+                                           ", tile_row FROM map")
+                                        : ("SELECT zoom_level, tile_column"
+                                           ", tile_row FROM tiles"))
+                                   , -1 // read until \0
+                                   , &stmt.stmt, nullptr)
+              , db, "sqlite3_prepare_v2")) { return {}; }
+
+    auto presence(std::make_shared<TilePresence>());
+    for (;;) {
+        const auto res(::sqlite3_step(stmt));
+        if (res == SQLITE_DONE) { break; }
+        if (res != SQLITE_ROW) {
+            check(res, db, "sqlite3_step");
+            return {};
+        }
+
+        // tiles out of bounds can never be asked for
+        const auto zoom(::sqlite3_column_int64(stmt, 0));
+        if ((zoom < 0) || (zoom > 30)) { continue; }
+        const auto col(::sqlite3_column_int64(stmt, 1));
+        const auto row(::sqlite3_column_int64(stmt, 2));
+        const auto max((1ll << zoom) - 1);
+        if ((col < 0) || (col > max) || (row < 0) || (row > max)) {
+            continue;
+        }
+
+        presence->set(zoom, col, row);
+    }
+
+    LOG(info1) << "Built index of " << presence->count() << " tiles of <"
+               << archive << ">.";
+
+    if (!options.tileIndexFile.empty()) {
+        presence->save(options.tileIndexFile, stamp);
+    }
+
+    return presence;
+}
+
+/** Tile indices of archives with tile index enabled.
+ */
+class TilePresenceRegistry {
+public:
+    /** Returns tile index of given archive, null pointer if index is not
+     *  enabled or cannot be built. Index is built on first access.
+     */
+    TilePresence::pointer get(const std::string &archive);
+
+    /** Forgets index of given archive.
+     */
+    void drop(const std::string &archive);
+
+    /** Forgets index of given archive if the archive file has changed since
+     *  the index was built.
+     */
+    void validate(const std::string &archive);
+
+    static TilePresenceRegistry& instance() {
+        static TilePresenceRegistry registry;
+        return registry;
+    }
+
+private:
+    struct Entry {
+        std::mutex mutex;
+        bool built;
+        TilePresence::Stamp stamp;
+        TilePresence::pointer presence;
+
+        Entry() : built(false) {}
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Entry>> entries_;
+};
+
+TilePresence::pointer TilePresenceRegistry::get(const std::string &archive)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fentries(entries_.find(archive));
+        if (fentries != entries_.end()) {
+            entry = fentries->second;
+        } else {
+            const auto options(ReadOptionsRegistry::instance().get(archive));
+            if (!options.tileIndex) { return {}; }
+            entry = std::make_shared<Entry>();
+            entries_.emplace(archive, entry);
+        }
+    }
+
+    // build outside of registry lock, other archives are not blocked
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (!entry->built) {
+        entry->stamp = archiveStamp(archive);
+        entry->presence = buildTilePresence
+            (archive, ReadOptionsRegistry::instance().get(archive)
+             , entry->stamp);
+        entry->built = true;
+    }
+    return entry->presence;
+}
+
+void TilePresenceRegistry::validate(const std::string &archive)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fentries(entries_.find(archive));
+        if (fentries == entries_.end()) { return; }
+        entry = fentries->second;
+    }
+
+    const auto stamp(archiveStamp(archive));
+    {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (!entry->built || ((entry->stamp.size == stamp.size)
+                              && (entry->stamp.mtime == stamp.mtime)))
+        {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto fentries(entries_.find(archive));
+    if ((fentries != entries_.end()) && (fentries->second == entry)) {
+        entries_.erase(fentries);
+    }
+}
+
+void TilePresenceRegistry::drop(const std::string &archive)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(archive);
+}
+
 inline bool isDigit(char c) { return (c >= '0') && (c <= '9'); }
 
 inline char positive(char c) { return c - '0'; }
@@ -123,9 +595,110 @@ bool check(int status, Database &db, const char *what)
     return true;
 }
 
-} // namespace
+/** Inflates gzipped data in one shot into reusable thread-local buffer.
+ *  Buffer is sized from gzip trailer (ISIZE) taken only as a hint: it is
+ *  capped by zlib's maximal compression ratio and buffer is grown if the
+ *  hint lies (e.g. concatenated members or size over 4 GiB). Buffer grown
+ *  by an unusually large tile is released on next call. Returns pointer to
+ *  inflated data (valid until next call in the same thread) or null
+ *  pointer on failure.
+ */
+const char* gunzip(const char *data, std::size_t size, std::size_t &outSize)
+{
+    thread_local std::vector<char> buffer;
 
-bool loadFromMbTilesArchive(vector_tile::Tile &tile, const char *path)
+    // ISIZE: uncompressed size modulo 2^32, little endian
+    std::size_t isize(0);
+    if (size >= 18) {
+        const auto *t(reinterpret_cast<const unsigned char*>
+                      (data + size - 4));
+        isize = (std::size_t(t[0]) | (std::size_t(t[1]) << 8)
+                 | (std::size_t(t[2]) << 16) | (std::size_t(t[3]) << 24));
+    }
+
+    // deflate never compresses better than 1032:1, larger ISIZE is a lie
+    isize = std::min(isize, size * 1032);
+
+    // do not keep memory of previous large tile forever
+    const std::size_t keepSize(1 << 22);
+    if ((buffer.size() > keepSize) && (isize < keepSize)) {
+        std::vector<char>().swap(buffer);
+    }
+
+    if (buffer.size() < isize + 1) { buffer.resize(isize + 1); }
+
+    ::z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    // 16 + MAX_WBITS: expect gzip header
+    if (::inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) { return nullptr; }
+
+    z.next_in = reinterpret_cast< ::Bytef*>(const_cast<char*>(data));
+    z.avail_in = ::uInt(size);
+
+    outSize = 0;
+    for (;;) {
+        z.next_out = reinterpret_cast< ::Bytef*>(buffer.data() + outSize);
+        z.avail_out = ::uInt(buffer.size() - outSize);
+
+        const auto res(::inflate(&z, Z_FINISH));
+        outSize = buffer.size() - z.avail_out;
+
+        if (res == Z_STREAM_END) {
+            if (!z.avail_in || (*z.next_in != 0x1f)) { break; }
+            // another gzip member follows
+            if (::inflateReset(&z) != Z_OK) { break; }
+            continue;
+        }
+
+        if ((res != Z_BUF_ERROR) && (res != Z_OK)) {
+            ::inflateEnd(&z);
+            return nullptr;
+        }
+
+        if (z.avail_out) {
+            // no progress possible: truncated input
+            ::inflateEnd(&z);
+            return nullptr;
+        }
+
+        buffer.resize(2 * buffer.size());
+    }
+
+    ::inflateEnd(&z);
+    return buffer.data();
+}
+
+/** Gzips data. Returns false on failure.
+ */
+bool gzip(const std::string &data, std::string &out)
+{
+    ::z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    if (::deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS
+                       , 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    // gzip header and trailer are not part of deflateBound
+    out.resize(::deflateBound(&z, data.size()) + 18);
+
+    z.next_in = reinterpret_cast< ::Bytef*>(const_cast<char*>(data.data()));
+    z.avail_in = ::uInt(data.size());
+    z.next_out = reinterpret_cast< ::Bytef*>(&out[0]);
+    z.avail_out = ::uInt(out.size());
+
+    const auto res(::deflate(&z, Z_FINISH));
+    out.resize(out.size() - z.avail_out);
+    ::deflateEnd(&z);
+
+    return (res == Z_STREAM_END);
+}
+
+/** Splits "archive.mbtiles/zoom-col-row" into archive path and tile index.
+ */
+bool parsePath(const char *path, std::string &archive, unsigned int &zoom
+               , unsigned int &col, unsigned int &row)
 {
     // last slash
     const auto *p(::strrchr(path, '/'));
@@ -136,43 +709,178 @@ bool loadFromMbTilesArchive(vector_tile::Tile &tile, const char *path)
     }
 
     // try to parse zoom-row-col
-    unsigned int zoom(0), col(0), row(0);
     if (!parse(p + 1, zoom, col, row)) {
         ::CPLError(CE_Failure, CPLE_AppDefined
                    , "Unable to match zoom-col-row in the last element"
                    " of <%s>.", path);
+        return false;
     }
 
-    unsigned int max((1 << zoom) - 1);
+    archive.assign(path, p);
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<MbTilesReadOptions>
+MbTilesReadOptions::parse(char **openOptions)
+{
+    const char *immutable(::CSLFetchNameValue(openOptions
+                                              , "SQLITE_IMMUTABLE"));
+    const char *noLock(::CSLFetchNameValue(openOptions, "SQLITE_NOLOCK"));
+    const char *mmapSize(::CSLFetchNameValue(openOptions
+                                             , "SQLITE_MMAP_SIZE"));
+    const char *cacheSize(::CSLFetchNameValue(openOptions
+                                              , "SQLITE_CACHE_SIZE"));
+    const char *tileIndex(::CSLFetchNameValue(openOptions, "TILE_INDEX"));
+    const char *tileIndexFile(::CSLFetchNameValue(openOptions
+                                                  , "TILE_INDEX_FILE"));
+
+    if (!immutable && !noLock && !mmapSize && !cacheSize && !tileIndex
+        && !tileIndexFile)
+    {
+        return {};
+    }
+
+    std::unique_ptr<MbTilesReadOptions> options(new MbTilesReadOptions());
+    if (immutable) { options->immutable = ::CPLTestBool(immutable); }
+    if (noLock) { options->noLock = ::CPLTestBool(noLock); }
+    if (mmapSize) { options->mmapSize = std::atoll(mmapSize); }
+    if (cacheSize) { options->cacheSize = std::atoll(cacheSize); }
+    if (tileIndex) { options->tileIndex = ::CPLTestBool(tileIndex); }
+    if (tileIndexFile) {
+        options->tileIndex = true;
+        options->tileIndexFile = tileIndexFile;
+    }
+    return options;
+}
+
+void configureMbTilesArchive(const std::string &archive
+                             , const MbTilesReadOptions &options)
+{
+    const auto previous(ReadOptionsRegistry::instance()
+                        .exchange(archive, options));
+
+    // same settings: keep pooled connections and index unless archive has
+    // changed on disk
+    if (previous == options) {
+        TilePresenceRegistry::instance().validate(archive);
+        return;
+    }
+
+    // connections opened with old SQLite settings
+    if ((previous.immutable != options.immutable)
+        || (previous.noLock != options.noLock)
+        || (previous.mmapSize != options.mmapSize)
+        || (previous.cacheSize != options.cacheSize))
+    {
+        ConnectionPool::instance().drop(archive);
+    }
+
+    // index built with old settings
+    TilePresenceRegistry::instance().drop(archive);
+}
+
+bool loadFromMbTilesArchive(vector_tile::Tile &tile, const char *path)
+{
+    std::string archive;
+    unsigned int zoom(0), col(0), row(0);
+    if (!parsePath(path, archive, zoom, col, row)) { return false; }
+
+    return loadFromMbTilesArchive(tile, archive, zoom, col, row);
+}
+
+namespace {
+
+/** Found tile. Data are read from database only when asked for.
+ */
+class TileRow {
+public:
+    TileRow(::sqlite3_stmt *stmt, const std::string &path)
+        : stmt_(stmt), path_(path)
+    {}
+
+    /** Tile ID in deduplicated archive, empty otherwise.
+     */
+    std::string tileId() const { return textColumn(stmt_, 0); }
+
+    /** Gets tile data. Returns false on failure.
+     */
+    bool data(const char *&blob, std::size_t &size) const;
+
+private:
+    ::sqlite3_stmt *stmt_;
+    const std::string &path_;
+};
+
+bool TileRow::data(const char *&blob, std::size_t &size) const
+{
+    blob = static_cast<const char*>(::sqlite3_column_blob(stmt_, 1));
+    if (!blob) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "Unable to get blob from query result (%s)"
+                   , path_.c_str());
+        return false;
+    }
+
+    size = ::sqlite3_column_bytes(stmt_, 1);
+    if (!size) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "Empty blob in query result (%s)", path_.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/** Fetches single tile from archive and passes it to process. Row is
+ *  counted from top (XYZ scheme).
+ */
+bool queryTile(const std::string &mbtiles
+               , unsigned int zoom, unsigned int col
+               , unsigned int row, bool reportMissing
+               , const std::function<bool(const TileRow&)> &process)
+{
+    const auto *path(mbtiles.c_str());
+
+    if (zoom > 30) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "Zoom %u is out-of-bound (0-30) in <%s>.", zoom, path);
+        return false;
+    }
+
+    unsigned int max((1u << zoom) - 1);
 
     if ((col > max) || (row > max)) {
         ::CPLError(CE_Failure, CPLE_AppDefined
-                   , "Values in zoom-col-row in the last element"
-                   " of <%s> are out-of-bound (0-%d).", path, max);
+                   , "Values in zoom-col-row %u-%u-%u"
+                   " are out-of-bound (0-%u) in <%s>."
+                   , zoom, col, row, max, path);
+        return false;
     }
 
     // switch row from bottom to top
     row = max - row;
 
-    const std::string mbtiles(path, p);
+    const auto missing([&]() -> bool
+    {
+        if (!reportMissing) { return false; }
+        ::CPLError(CE_Failure, CPLE_OpenFailed
+                   , "No tile %d-%d-%d found in database file <%s>."
+                   , zoom, col, row, mbtiles.c_str());
+        return false;
+    });
 
-    // open database
-    Database db(mbtiles);
-    if (check(::sqlite3_open_v2(mbtiles.c_str(), &db.db, SQLITE_OPEN_READONLY
-                                , nullptr)
-              , db, "sqlite3_open_v2"))  { return false; }
+    // tile known to be missing, no need to ask database
+    if (auto presence = TilePresenceRegistry::instance().get(mbtiles)) {
+        if (!presence->has(zoom, col, row)) { return missing(); }
+    }
 
-    // prepare statement
-    Statement stmt;
-    if (check(::sqlite3_prepare(db
-                                , ("SELECT tile_data "
-                                   "FROM tiles WHERE zoom_level=?"
-                                   "     AND tile_column=?"
-                                   "     AND tile_row=?")
-                                , -1 // read until \0
-                                , &stmt.stmt
-                                , nullptr)
-              , db, "sqlite3_prepare")) { return false; }
+    // borrow pooled connection, blob is valid until lease ends
+    Lease lease(mbtiles);
+    if (!lease.conn) { return false; }
+    auto &db(lease.conn->db);
+    auto &stmt(lease.conn->selectTile);
 
     // bind
     if (check(::sqlite3_bind_int(stmt, 1, zoom), db, "sqlite3_bind_int"))
@@ -185,43 +893,706 @@ bool loadFromMbTilesArchive(vector_tile::Tile &tile, const char *path)
     switch (auto res = ::sqlite3_step(stmt)) {
     case SQLITE_ROW: break;
 
+    case SQLITE_DONE: return missing();
+
+    default:
+        check(res, db, "sqlite3_step");
+        return false;
+    }
+
+    return process(TileRow(stmt, mbtiles));
+}
+
+typedef LruCache<std::string, vector_tile::Tile> SharedTileCache;
+
+/** Decoded tiles of deduplicated archives keyed by archive and tile_id.
+ *  Budget (in bytes) is taken from MBTILES_SHARED_CACHE_SIZE configuration
+ *  option (32 MiB by default).
+ */
+SharedTileCache& sharedTileCache()
+{
+    static SharedTileCache cache
+        (std::strtoull(::CPLGetConfigOption("MBTILES_SHARED_CACHE_SIZE"
+                                            , "33554432")
+                       , nullptr, 10));
+    return cache;
+}
+
+std::string sharedTileKey(const std::string &archive
+                          , const std::string &tileId)
+{
+    std::string key(archive);
+    key.push_back('\0');
+    key += tileId;
+    return key;
+}
+
+} // namespace
+
+bool loadFromMbTilesArchive(vector_tile::Tile &tile
+                            , const std::string &mbtiles
+                            , unsigned int zoom, unsigned int col
+                            , unsigned int row, bool reportMissing)
+{
+    return queryTile(mbtiles, zoom, col, row, reportMissing
+                     , [&tile](const TileRow &tileRow)
+    {
+        const char *data;
+        std::size_t size;
+        if (!tileRow.data(data, size)) { return false; }
+        return decodeMbTile(tile, data, size);
+    });
+}
+
+SharedMbTile loadSharedFromMbTilesArchive(const char *path)
+{
+    std::string archive;
+    unsigned int zoom(0), col(0), row(0);
+    if (!parsePath(path, archive, zoom, col, row)) { return {}; }
+
+    return loadSharedFromMbTilesArchive(archive, zoom, col, row);
+}
+
+SharedMbTile loadSharedFromMbTilesArchive(const std::string &mbtiles
+                                          , unsigned int zoom
+                                          , unsigned int col
+                                          , unsigned int row
+                                          , bool reportMissing)
+{
+    SharedMbTile tile;
+    queryTile(mbtiles, zoom, col, row, reportMissing
+              , [&](const TileRow &tileRow) -> bool
+    {
+        // shared tile already decoded -> data are not even read
+        const auto tileId(tileRow.tileId());
+        if (!tileId.empty()) {
+            tile = sharedTileCache().get(sharedTileKey(mbtiles, tileId));
+            if (tile) { return true; }
+        }
+
+        const char *data;
+        std::size_t size;
+        if (!tileRow.data(data, size)) { return false; }
+        tile = decodeSharedMbTile(mbtiles, tileId, data, size);
+        return bool(tile);
+    });
+    return tile;
+}
+
+SharedMbTile decodeSharedMbTile(const std::string &archive
+                                , const std::string &tileId
+                                , const char *data, std::size_t size)
+{
+    if (tileId.empty()) {
+        auto tile(std::make_shared<vector_tile::Tile>());
+        if (!decodeMbTile(*tile, data, size)) { return {}; }
+        return tile;
+    }
+
+    auto &cache(sharedTileCache());
+    const auto key(sharedTileKey(archive, tileId));
+    if (auto tile = cache.get(key)) { return tile; }
+
+    auto tile(std::make_shared<vector_tile::Tile>());
+    if (!decodeMbTile(*tile, data, size)) { return {}; }
+    cache.put(key, tile, tile->SpaceUsedLong());
+    return tile;
+}
+
+bool readMbTileData(const std::string &mbtiles
+                    , unsigned int zoom, unsigned int col
+                    , unsigned int row, std::string &data
+                    , bool reportMissing, std::string *tileId)
+{
+    return queryTile(mbtiles, zoom, col, row, reportMissing
+                     , [&](const TileRow &tileRow)
+    {
+        const char *blob;
+        std::size_t size;
+        if (!tileRow.data(blob, size)) { return false; }
+        data.assign(blob, size);
+        if (tileId) { *tileId = tileRow.tileId(); }
+        return true;
+    });
+}
+
+bool mbTilesZoomRange(const std::string &archive, unsigned int &minZoom
+                      , unsigned int &maxZoom)
+{
+    Database db(archive);
+    if (!openReadOnly(db, false)) { return false; }
+
+    Statement stmt;
+    if (check(::sqlite3_prepare_v2(db, ("SELECT MIN(zoom_level)"
+                                        ", MAX(zoom_level) FROM tiles")
+                                   , -1 // read until \0
+                                   , &stmt.stmt, nullptr)
+              , db, "sqlite3_prepare_v2")) { return false; }
+
+    const auto res(::sqlite3_step(stmt));
+    if (res != SQLITE_ROW) {
+        check(res, db, "sqlite3_step");
+        return false;
+    }
+
+    if (::sqlite3_column_type(stmt, 0) == SQLITE_NULL) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "No tiles in database file <%s>.", archive.c_str());
+        return false;
+    }
+
+    minZoom = ::sqlite3_column_int(stmt, 0);
+    maxZoom = ::sqlite3_column_int(stmt, 1);
+    return true;
+}
+
+
+bool decodeMbTile(vector_tile::Tile &tile, const char *data
+                  , std::size_t size)
+{
+    if (!size || (*data != 0x1f)) {
+        // probably not gzipped -> return as is
+        return tile.ParseFromArray(data, size);
+    };
+
+    // gunzip into flat buffer and decode
+    std::size_t inflatedSize(0);
+    const auto *inflated(gunzip(data, size, inflatedSize));
+    if (!inflated) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "Unable to gunzip tile data.");
+        return false;
+    }
+
+    return tile.ParseFromArray(inflated, inflatedSize);
+}
+
+bool readMbTilesMetadata(const std::string &archive
+                         , std::map<std::string, std::string> &metadata)
+{
+    Database db(archive);
+    if (!openReadOnly(db, false)) { return false; }
+
+    Statement stmt;
+    if (check(::sqlite3_prepare_v2(db, "SELECT name, value FROM metadata"
+                                   , -1 // read until \0
+                                   , &stmt.stmt, nullptr)
+              , db, "sqlite3_prepare_v2")) { return false; }
+
+    for (;;) {
+        switch (auto res = ::sqlite3_step(stmt)) {
+        case SQLITE_ROW: {
+            const auto *name(::sqlite3_column_text(stmt, 0));
+            const auto *value(::sqlite3_column_text(stmt, 1));
+            if (name && value) {
+                metadata[reinterpret_cast<const char*>(name)]
+                    = reinterpret_cast<const char*>(value);
+            }
+            break;
+        }
+
+        case SQLITE_DONE: return true;
+
+        default:
+            check(res, db, "sqlite3_step");
+            return false;
+        }
+    }
+}
+
+struct MbTilesCursor::Detail {
+    Detail(const std::string &archive, unsigned int zoom)
+        : db(archive), max((1u << zoom) - 1), valid(false), failed(true)
+    {}
+
+    Database db;
+    Statement stmt;
+    unsigned int max;
+    bool valid;
+    bool failed;
+};
+
+MbTilesCursor::MbTilesCursor(const std::string &archive, unsigned int zoom
+                             , unsigned int colMin, unsigned int rowMin
+                             , unsigned int colMax, unsigned int rowMax
+                             , bool rowMajor)
+    : detail_(new Detail(archive, std::min(zoom, 30u)))
+{
+    auto &db(detail_->db);
+    auto &stmt(detail_->stmt);
+    const auto max(detail_->max);
+
+    if (!openReadOnly(db, true)) { return; }
+
+    bool deduplicated(false);
+    if (!detectDeduplicated(db, deduplicated)) { return; }
+
+    const auto sql(selectRangeSql(deduplicated, rowMajor));
+    if (check(::sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt.stmt, nullptr)
+              , db, "sqlite3_prepare_v2")) { return; }
+
+    // rows are stored from bottom
+    rowMax = std::min(rowMax, max);
+    if (check(::sqlite3_bind_int(stmt, 1, zoom), db, "sqlite3_bind_int")
+        || check(::sqlite3_bind_int(stmt, 2, colMin), db, "sqlite3_bind_int")
+        || check(::sqlite3_bind_int(stmt, 3, colMax), db, "sqlite3_bind_int")
+        || check(::sqlite3_bind_int(stmt, 4, max - rowMax)
+                 , db, "sqlite3_bind_int")
+        || check(::sqlite3_bind_int(stmt, 5, max - rowMin)
+                 , db, "sqlite3_bind_int"))
+    {
+        return;
+    }
+
+    detail_->valid = true;
+    detail_->failed = false;
+}
+
+MbTilesCursor::~MbTilesCursor() {}
+
+bool MbTilesCursor::valid() const { return detail_->valid; }
+
+bool MbTilesCursor::failed() const { return detail_->failed; }
+
+bool MbTilesCursor::next(unsigned int &col, unsigned int &row
+                         , std::string &data, std::string *tileId)
+{
+    if (!detail_->valid) { return false; }
+    auto &stmt(detail_->stmt);
+
+    switch (auto res = ::sqlite3_step(stmt)) {
+    case SQLITE_ROW: break;
+
     case SQLITE_DONE:
-        ::CPLError(CE_Failure, CPLE_OpenFailed
-                   , "No tile %d-%d-%d found in database file <%s>."
-                   , zoom, col, row, mbtiles.c_str());
+        detail_->valid = false;
         return false;
 
     default:
+        check(res, detail_->db, "sqlite3_step");
+        detail_->valid = false;
+        detail_->failed = true;
+        return false;
+    }
+
+    col = ::sqlite3_column_int(stmt, 0);
+    row = detail_->max - ::sqlite3_column_int(stmt, 1);
+
+    const auto *blob(static_cast<const char*>
+                     (::sqlite3_column_blob(stmt, 2)));
+    data.assign(blob ? blob : "", ::sqlite3_column_bytes(stmt, 2));
+    if (tileId) { *tileId = textColumn(stmt, 3); }
+    return true;
+}
+
+namespace {
+
+struct RawTile {
+    unsigned int col;
+    unsigned int row;
+    std::string data;
+    std::string tileId;
+};
+
+struct DecodedTile {
+    unsigned int col;
+    unsigned int row;
+    SharedMbTile tile;
+};
+
+typedef std::function<bool(unsigned int, unsigned int)> TileFilter;
+
+bool loadBulk(const std::string &archive, unsigned int zoom
+              , unsigned int colMin, unsigned int rowMin
+              , unsigned int colMax, unsigned int rowMax
+              , const TileFilter &filter
+              , const MbTileCallback &callback
+              , const MbTilesBulkOptions &options)
+{
+    if (zoom > 30) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "Zoom %u is out-of-bound (0-30) in <%s>."
+                   , zoom, archive.c_str());
+        return false;
+    }
+
+    // nothing outside of zoom level
+    const unsigned int max((1u << zoom) - 1);
+    if ((colMin > max) || (rowMin > max)
+        || (colMin > colMax) || (rowMin > rowMax))
+    {
+        return true;
+    }
+
+    auto cursor(std::make_shared<MbTilesCursor>
+                (archive, zoom, colMin, rowMin, colMax, rowMax
+                 , options.rowMajor));
+    if (!cursor->valid()) { return false; }
+
+    const auto fetch([cursor, filter](RawTile &raw) -> bool
+    {
+        while (cursor->next(raw.col, raw.row, raw.data, &raw.tileId)) {
+            if (!filter || filter(raw.col, raw.row)) { return true; }
+        }
+        return false;
+    });
+
+    const auto process([archive](const RawTile &raw, DecodedTile &decoded)
+    {
+        decoded.col = raw.col;
+        decoded.row = raw.row;
+        ::CPLPushErrorHandler(::CPLQuietErrorHandler);
+        decoded.tile = decodeSharedMbTile(archive, raw.tileId
+                                          , raw.data.data()
+                                          , raw.data.size());
+        ::CPLPopErrorHandler();
+    });
+
+    const auto threads(options.threads ? options.threads
+                       : std::max(std::thread::hardware_concurrency(), 1u));
+    const auto lookahead(options.lookahead ? options.lookahead
+                         : 2 * threads);
+
+    {
+        Prefetcher<RawTile, DecodedTile> prefetcher
+            (fetch, process, threads, lookahead);
+
+        DecodedTile decoded;
+        while (prefetcher.next(decoded)) {
+            if (!callback(decoded.col, decoded.row, decoded.tile)) {
+                return true;
+            }
+        }
+    }
+
+    return !cursor->failed();
+}
+
+} // namespace
+
+bool loadMbTilesRange(const std::string &archive, unsigned int zoom
+                      , unsigned int colMin, unsigned int rowMin
+                      , unsigned int colMax, unsigned int rowMax
+                      , const MbTileCallback &callback
+                      , const MbTilesBulkOptions &options)
+{
+    return loadBulk(archive, zoom, colMin, rowMin, colMax, rowMax
+                    , TileFilter(), callback, options);
+}
+
+bool loadMbTiles(const std::string &archive, unsigned int zoom
+                 , const std::vector<std::pair<unsigned int, unsigned int>>
+                 &tiles
+                 , const MbTileCallback &callback
+                 , const MbTilesBulkOptions &options)
+{
+    if (tiles.empty()) { return true; }
+
+    // bounding range of listed tiles
+    auto colMin(tiles.front().first), colMax(colMin);
+    auto rowMin(tiles.front().second), rowMax(rowMin);
+    for (const auto &tile : tiles) {
+        colMin = std::min(colMin, tile.first);
+        colMax = std::max(colMax, tile.first);
+        rowMin = std::min(rowMin, tile.second);
+        rowMax = std::max(rowMax, tile.second);
+    }
+
+    auto wanted(std::make_shared
+                <std::set<std::pair<unsigned int, unsigned int>>>
+                (tiles.begin(), tiles.end()));
+
+    return loadBulk(archive, zoom, colMin, rowMin, colMax, rowMax
+                    , [wanted](unsigned int col, unsigned int row)
+                    {
+                        return wanted->count(std::make_pair(col, row)) > 0;
+                    }
+                    , callback, options);
+}
+
+namespace {
+
+/** Blob query parameter.
+ */
+struct Blob {
+    const std::string &data;
+};
+
+bool bindValue(Database &db, Statement &stmt, int index, unsigned int value)
+{
+    return !check(::sqlite3_bind_int(stmt, index, value)
+                  , db, "sqlite3_bind_int");
+}
+
+bool bindValue(Database &db, Statement &stmt, int index
+               , const std::string &value)
+{
+    return !check(::sqlite3_bind_text(stmt, index, value.data()
+                                      , value.size(), SQLITE_STATIC)
+                  , db, "sqlite3_bind_text");
+}
+
+bool bindValue(Database &db, Statement &stmt, int index, const Blob &value)
+{
+    return !check(::sqlite3_bind_blob(stmt, index, value.data.data()
+                                      , value.data.size(), SQLITE_STATIC)
+                  , db, "sqlite3_bind_blob");
+}
+
+inline bool bindValues(Database&, Statement&, int) { return true; }
+
+template <typename T, typename ...Args>
+bool bindValues(Database &db, Statement &stmt, int index, const T &value
+                , const Args &...args)
+{
+    return (bindValue(db, stmt, index, value)
+            && bindValues(db, stmt, index + 1, args...));
+}
+
+/** Prepares statement and binds all arguments.
+ */
+template <typename ...Args>
+bool prepare(Database &db, Statement &stmt, const char *sql
+             , const Args &...args)
+{
+    if (check(::sqlite3_prepare_v2(db, sql, -1, &stmt.stmt, nullptr)
+              , db, "sqlite3_prepare_v2")) { return false; }
+    return bindValues(db, stmt, 1, args...);
+}
+
+/** Executes statement, result rows (if any) are ignored.
+ */
+template <typename ...Args>
+bool execute(Database &db, const char *sql, const Args &...args)
+{
+    Statement stmt;
+    if (!prepare(db, stmt, sql, args...)) { return false; }
+
+    const auto res(::sqlite3_step(stmt));
+    if ((res != SQLITE_DONE) && (res != SQLITE_ROW)) {
         check(res, db, "sqlite3_step");
         return false;
     }
+    return true;
+}
 
-    // get blob
-    const char *blob(static_cast<const char*>(::sqlite3_column_blob(stmt, 0)));
-    if (!blob) {
+/** Rolls back transaction unless committed.
+ */
+class Transaction {
+public:
+    Transaction(Database &db)
+        : db_(db), active_(execute(db, "BEGIN IMMEDIATE"))
+    {}
+
+    ~Transaction() {
+        if (active_) { ::sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr
+                                      , nullptr); }
+    }
+
+    bool valid() const { return active_; }
+
+    bool commit() {
+        active_ = false;
+        return execute(db_, "COMMIT");
+    }
+
+private:
+    Database &db_;
+    bool active_;
+};
+
+/** Writes tile into plain archive (tiles table). Row is in TMS scheme.
+ */
+bool writePlainTile(Database &db, unsigned int zoom, unsigned int col
+                    , unsigned int row, const std::string &data)
+{
+    if (check(::sqlite3_exec(db
+                             , ("CREATE TABLE IF NOT EXISTS metadata"
+                                " (name text, value text);"
+                                "CREATE TABLE IF NOT EXISTS tiles"
+                                " (zoom_level integer, tile_column integer"
+                                ", tile_row integer, tile_data blob);"
+                                "CREATE UNIQUE INDEX IF NOT EXISTS tile_index"
+                                " ON tiles (zoom_level, tile_column"
+                                ", tile_row);")
+                             , nullptr, nullptr, nullptr)
+              , db, "sqlite3_exec")) { return false; }
+
+    return execute(db, ("INSERT OR REPLACE INTO tiles"
+                        " (zoom_level, tile_column, tile_row"
+                        ", tile_data) VALUES (?, ?, ?, ?)")
+                   , zoom, col, row, Blob{data});
+}
+
+/** Content based tile ID: equal data share image.
+ */
+std::string contentTileId(const std::string &data)
+{
+    const auto *bytes(reinterpret_cast<const ::Bytef*>(data.data()));
+    const auto crc(::crc32(::crc32(0, nullptr, 0), bytes, data.size()));
+    const auto adler(::adler32(::adler32(0, nullptr, 0), bytes
+                               , data.size()));
+
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%08lx%08lx%zx"
+                  , static_cast<unsigned long>(crc)
+                  , static_cast<unsigned long>(adler), data.size());
+    return buf;
+}
+
+/** Writes tile into deduplicated archive (map and images tables). Image is
+ *  shared with other tiles with the same content, image no longer
+ *  referenced by any tile is removed. Row is in TMS scheme.
+ */
+bool writeDeduplicatedTile(Database &db, unsigned int zoom, unsigned int col
+                           , unsigned int row, const std::string &data)
+{
+    Transaction tx(db);
+    if (!tx.valid()) { return false; }
+
+    // store image unless already present
+    auto tileId(contentTileId(data));
+    if (!execute(db, ("INSERT OR IGNORE INTO images (tile_data, tile_id)"
+                      " VALUES (?, ?)"), Blob{data}, tileId))
+    {
+        return false;
+    }
+
+    // checksum collision: make ID unique for this tile
+    {
+        Statement stmt;
+        if (!prepare(db, stmt, "SELECT tile_data FROM images"
+                     " WHERE tile_id = ?", tileId))
+        {
+            return false;
+        }
+
+        if (::sqlite3_step(stmt) == SQLITE_ROW) {
+            const auto *blob(static_cast<const char*>
+                             (::sqlite3_column_blob(stmt, 0)));
+            const std::size_t size(::sqlite3_column_bytes(stmt, 0));
+            if ((size != data.size())
+                || (size && std::memcmp(blob, data.data(), size)))
+            {
+                tileId += "@" + std::to_string(zoom) + "-"
+                    + std::to_string(col) + "-" + std::to_string(row);
+                if (!execute(db, ("INSERT OR REPLACE INTO images"
+                                  " (tile_data, tile_id) VALUES (?, ?)")
+                             , Blob{data}, tileId))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // previous image of this tile
+    std::string oldTileId;
+    {
+        Statement stmt;
+        if (!prepare(db, stmt, ("SELECT tile_id FROM map WHERE zoom_level=?"
+                                " AND tile_column=? AND tile_row=?")
+                     , zoom, col, row))
+        {
+            return false;
+        }
+        if (::sqlite3_step(stmt) == SQLITE_ROW) {
+            oldTileId = textColumn(stmt, 0);
+        }
+    }
+
+    // map index need not be unique, replace manually
+    if (!execute(db, ("DELETE FROM map WHERE zoom_level=?"
+                      " AND tile_column=? AND tile_row=?")
+                 , zoom, col, row)
+        || !execute(db, ("INSERT INTO map (zoom_level, tile_column"
+                         ", tile_row, tile_id) VALUES (?, ?, ?, ?)")
+                    , zoom, col, row, tileId))
+    {
+        return false;
+    }
+
+    if (!oldTileId.empty() && (oldTileId != tileId)
+        && !execute(db, ("DELETE FROM images WHERE tile_id = ?"
+                         " AND NOT EXISTS (SELECT 1 FROM map"
+                         " WHERE tile_id = ?)"), oldTileId, oldTileId))
+    {
+        return false;
+    }
+
+    return tx.commit();
+}
+
+} // namespace
+
+bool saveToMbTilesArchive(const std::string &data, const char *path)
+{
+    std::string mbtiles;
+    unsigned int zoom(0), col(0), row(0);
+    if (!parsePath(path, mbtiles, zoom, col, row)) { return false; }
+
+    if (zoom > 30) {
         ::CPLError(CE_Failure, CPLE_AppDefined
-                   , "Unable to get blob from query result (%s)", path);
+                   , "Zoom %u is out-of-bound (0-30) in <%s>.", zoom, path);
         return false;
     }
-    const auto blobSize(::sqlite3_column_bytes(stmt, 0));
 
-    if (!blobSize) {
+    unsigned int max((1u << zoom) - 1);
+    if ((col > max) || (row > max)) {
         ::CPLError(CE_Failure, CPLE_AppDefined
-                   , "Empty blob in query result (%s)", path);
+                   , "Values in zoom-col-row in the last element"
+                   " of <%s> are out-of-bound (0-%u).", path, max);
         return false;
     }
 
-    if (*blob != 0x1f) {
-        // probably not gzipped -> return as is
-        return tile.ParseFromArray(blob, blobSize);
-    };
+    // switch row from bottom to top
+    row = max - row;
+
+    // gzip data
+    std::string gzipped;
+    if (!gzip(data, gzipped)) {
+        ::CPLError(CE_Failure, CPLE_AppDefined
+                   , "Unable to gzip tile data for <%s>.", path);
+        return false;
+    }
+
+    // open (and create) database
+    Database db(mbtiles);
+    if (check(::sqlite3_open_v2(mbtiles.c_str(), &db.db
+                                , (SQLITE_OPEN_READWRITE
+                                   | SQLITE_OPEN_CREATE)
+                                , nullptr)
+              , db, "sqlite3_open_v2"))  { return false; }
+
+    // tiles is only a view in deduplicated archive
+    bool deduplicated(false);
+    if (!detectDeduplicated(db, deduplicated)) { return false; }
 
-    // gunzip and decode
-    bio::stream_buffer<bio::array_source> buffer(blob, blob + blobSize);
-    bio::filtering_istream gzipped;
-    gzipped.push(bio::gzip_decompressor());
-    gzipped.push(buffer);
-    return tile.ParseFromIstream(&gzipped);
+    if (deduplicated) {
+        if (!writeDeduplicatedTile(db, zoom, col, row, gzipped)) {
+            return false;
+        }
+    } else if (!writePlainTile(db, zoom, col, row, gzipped)) {
+        return false;
+    }
+
+    // tile index (if any) is stale now, rebuilt on next access
+    TilePresenceRegistry::instance().drop(mbtiles);
+
+    // decoded tiles of this archive may be stale
+    {
+        const auto prefix(sharedTileKey(mbtiles, {}));
+        sharedTileCache().erase([&prefix](const std::string &key)
+        {
+            return !key.compare(0, prefix.size(), prefix);
+        });
+    }
+
+    // immutable connections would never see the change
+    if (ReadOptionsRegistry::instance().get(mbtiles).immutable) {
+        ConnectionPool::instance().drop(mbtiles);
+    }
+
+    return true;
 }
 
 } } // namespace gdal_drivers::detail
@@ -27,12 +27,232 @@
 #ifndef gdal_drivers_detail_mbtiles_hpp_included_
 #define gdal_drivers_detail_mbtiles_hpp_included_
 
+#include <cstddef>
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <functional>
+
 namespace vector_tile { class Tile; }
 
 namespace gdal_drivers { namespace detail {
 
+/** SQLite tuning used when opening archive for reading.
+ */
+struct MbTilesReadOptions {
+    /** Archive never changes: open as immutable (no locking, no change
+     *  detection).
+     */
+    bool immutable;
+
+    /** Disable file locking.
+     */
+    bool noLock;
+
+    /** PRAGMA mmap_size in bytes, negative to keep default.
+     */
+    long long mmapSize;
+
+    /** Page cache size in bytes, negative to keep default.
+     */
+    long long cacheSize;
+
+    /** Keep in-memory index of existing tiles (built on first access);
+     *  missing tiles are then rejected without touching the database.
+     */
+    bool tileIndex;
+
+    /** Sidecar file the tile index is persisted in, empty to keep it in
+     *  memory only. Implies tileIndex.
+     */
+    std::string tileIndexFile;
+
+    MbTilesReadOptions()
+        : immutable(false), noLock(false), mmapSize(-1), cacheSize(-1)
+        , tileIndex(false)
+    {}
+
+    bool operator==(const MbTilesReadOptions &o) const {
+        return ((immutable == o.immutable) && (noLock == o.noLock)
+                && (mmapSize == o.mmapSize) && (cacheSize == o.cacheSize)
+                && (tileIndex == o.tileIndex)
+                && (tileIndexFile == o.tileIndexFile));
+    }
+
+    bool operator!=(const MbTilesReadOptions &o) const {
+        return !operator==(o);
+    }
+
+    /** Parses SQLITE_IMMUTABLE, SQLITE_NOLOCK, SQLITE_MMAP_SIZE,
+     *  SQLITE_CACHE_SIZE, TILE_INDEX and TILE_INDEX_FILE open options.
+     *  Returns null pointer if no option is set.
+     */
+    static std::unique_ptr<MbTilesReadOptions> parse(char **openOptions);
+};
+
+/** Sets read options for all connections to given archive opened from now
+ *  on. If SQLite settings differ from the current ones, idle pooled
+ *  connections are closed. Tile index is rebuilt if its settings or archive
+ *  file (size, modification time) have changed.
+ */
+void configureMbTilesArchive(const std::string &archive
+                             , const MbTilesReadOptions &options);
+
+/** Loads tile from path in form "archive.mbtiles/zoom-col-row".
+ */
 bool loadFromMbTilesArchive(vector_tile::Tile &tile, const char *path);
 
+/** Loads tile from archive. Row is counted from top (XYZ scheme). Missing
+ *  tile is reported via CPLError only if reportMissing is set.
+ */
+bool loadFromMbTilesArchive(vector_tile::Tile &tile, const std::string &archive
+                            , unsigned int zoom, unsigned int col
+                            , unsigned int row, bool reportMissing = true);
+
+/** Decoded tile that may be shared with other users.
+ */
+typedef std::shared_ptr<const vector_tile::Tile> SharedMbTile;
+
+/** Loads tile from path in form "archive.mbtiles/zoom-col-row". Returns null
+ *  pointer on failure.
+ *
+ *  Tiles of deduplicated archives (map/images schema) are cached by their
+ *  tile_id: tiles sharing one blob are decoded once and shared.
+ */
+SharedMbTile loadSharedFromMbTilesArchive(const char *path);
+
+/** Loads tile from archive, see above. Row is counted from top (XYZ scheme).
+ */
+SharedMbTile loadSharedFromMbTilesArchive(const std::string &archive
+                                          , unsigned int zoom
+                                          , unsigned int col
+                                          , unsigned int row
+                                          , bool reportMissing = true);
+
+/** Decodes tile data read from archive. Non-empty tileId (deduplicated
+ *  archives) makes use of shared tile cache.
+ */
+SharedMbTile decodeSharedMbTile(const std::string &archive
+                                , const std::string &tileId
+                                , const char *data, std::size_t size);
+
+/** Reads raw tile data (as stored in archive) from archive. Row is counted
+ *  from top (XYZ scheme). Missing tile is reported via CPLError only if
+ *  reportMissing is set. If tileId is given it receives tile_id of
+ *  deduplicated archive (empty otherwise).
+ */
+bool readMbTileData(const std::string &archive
+                    , unsigned int zoom, unsigned int col
+                    , unsigned int row, std::string &data
+                    , bool reportMissing = true
+                    , std::string *tileId = nullptr);
+
+/** Finds range of zoom levels present in archive's tiles table.
+ */
+bool mbTilesZoomRange(const std::string &archive, unsigned int &minZoom
+                      , unsigned int &maxZoom);
+
+/** Decodes tile data as stored in archive (gzipped or plain).
+ */
+bool decodeMbTile(vector_tile::Tile &tile, const char *data
+                  , std::size_t size);
+
+/** Reads archive's metadata table. Returns false on failure.
+ */
+bool readMbTilesMetadata(const std::string &archive
+                         , std::map<std::string, std::string> &metadata);
+
+/** Streams raw data of all tiles of single zoom level in given inclusive
+ *  tile range with a single query.
+ *
+ *  Tiles are returned in index order (column by column) unless rowMajor is
+ *  set; then they are returned row by row from top. Rows are counted from
+ *  top (XYZ scheme).
+ */
+class MbTilesCursor {
+public:
+    MbTilesCursor(const std::string &archive, unsigned int zoom
+                  , unsigned int colMin, unsigned int rowMin
+                  , unsigned int colMax, unsigned int rowMax
+                  , bool rowMajor);
+    ~MbTilesCursor();
+
+    /** Query is ready. If not, CPLError is set.
+     */
+    bool valid() const;
+
+    /** Fetches next tile. Returns false when there are no more tiles or on
+     *  error. If tileId is given it receives tile_id of deduplicated archive
+     *  (empty otherwise).
+     */
+    bool next(unsigned int &col, unsigned int &row, std::string &data
+              , std::string *tileId = nullptr);
+
+    /** Query failed (either at start or during iteration).
+     */
+    bool failed() const;
+
+private:
+    struct Detail;
+    std::unique_ptr<Detail> detail_;
+};
+
+/** Receives tiles from bulk loaders. Tile is null if it cannot be decoded.
+ *  Returning false stops loading.
+ */
+typedef std::function<bool(unsigned int col, unsigned int row
+                           , const SharedMbTile &tile)>
+MbTileCallback;
+
+/** Bulk loader options.
+ */
+struct MbTilesBulkOptions {
+    /** Number of decoding threads, hardware concurrency if zero.
+     */
+    unsigned int threads;
+
+    /** Maximum number of tiles in flight, 2 * threads if zero.
+     */
+    unsigned int lookahead;
+
+    /** Deliver tiles row by row from top, otherwise in index order.
+     */
+    bool rowMajor;
+
+    MbTilesBulkOptions() : threads(), lookahead(), rowMajor(false) {}
+};
+
+/** Loads all existing tiles of single zoom level in inclusive range (rows
+ *  counted from top) with a single ranged query.
+ *
+ *  Query runs on one thread at a time, decompression and decoding run on
+ *  worker pool. Callback is called from calling thread in query order.
+ *  Returns false on failure (CPLError is set).
+ */
+bool loadMbTilesRange(const std::string &archive, unsigned int zoom
+                      , unsigned int colMin, unsigned int rowMin
+                      , unsigned int colMax, unsigned int rowMax
+                      , const MbTileCallback &callback
+                      , const MbTilesBulkOptions &options
+                      = MbTilesBulkOptions());
+
+/** Loads listed tiles (col, row; rows counted from top) of single zoom
+ *  level. Single query over listed tiles' bounding range is used, missing
+ *  tiles are skipped. See loadMbTilesRange for details.
+ */
+bool loadMbTiles(const std::string &archive, unsigned int zoom
+                 , const std::vector<std::pair<unsigned int, unsigned int>>
+                 &tiles
+                 , const MbTileCallback &callback
+                 , const MbTilesBulkOptions &options = MbTilesBulkOptions());
+
+/** Stores (gzipped) tile data to path in form "archive.mbtiles/zoom-col-row".
+ *  Archive and its tables are created if missing, existing tile is replaced.
+ */
+bool saveToMbTilesArchive(const std::string &data, const char *path);
+
 } } // namespace gdal_drivers::detail
 
 #endif // gdal_drivers_detail_mbtiles_hpp_included_
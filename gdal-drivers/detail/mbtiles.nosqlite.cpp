@@ -29,6 +29,14 @@
 
 namespace gdal_drivers { namespace detail {
 
+std::unique_ptr<MbTilesReadOptions> MbTilesReadOptions::parse(char**)
+{
+    return {};
+}
+
+void configureMbTilesArchive(const std::string&, const MbTilesReadOptions&)
+{}
+
 bool loadFromMbTilesArchive(vector_tile::Tile&, const char*)
 {
     ::CPLError(CE_Failure, CPLE_NotSupported
@@ -37,4 +45,126 @@ bool loadFromMbTilesArchive(vector_tile::Tile&, const char*)
     return false;
 }
 
+bool loadFromMbTilesArchive(vector_tile::Tile&, const std::string&
+                            , unsigned int, unsigned int, unsigned int, bool)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+SharedMbTile loadSharedFromMbTilesArchive(const char*)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return {};
+}
+
+SharedMbTile loadSharedFromMbTilesArchive(const std::string&, unsigned int
+                                          , unsigned int, unsigned int
+                                          , bool)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return {};
+}
+
+SharedMbTile decodeSharedMbTile(const std::string&, const std::string&
+                                , const char*, std::size_t)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return {};
+}
+
+bool readMbTileData(const std::string&, unsigned int, unsigned int
+                    , unsigned int, std::string&, bool, std::string*)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+bool mbTilesZoomRange(const std::string&, unsigned int&, unsigned int&)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+bool decodeMbTile(vector_tile::Tile&, const char*, std::size_t)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+bool readMbTilesMetadata(const std::string&
+                         , std::map<std::string, std::string>&)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+struct MbTilesCursor::Detail {};
+
+MbTilesCursor::MbTilesCursor(const std::string&, unsigned int
+                             , unsigned int, unsigned int
+                             , unsigned int, unsigned int, bool)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+}
+
+MbTilesCursor::~MbTilesCursor() {}
+
+bool MbTilesCursor::valid() const { return false; }
+
+bool MbTilesCursor::next(unsigned int&, unsigned int&, std::string&
+                         , std::string*)
+{
+    return false;
+}
+
+bool MbTilesCursor::failed() const { return true; }
+
+bool loadMbTilesRange(const std::string&, unsigned int
+                      , unsigned int, unsigned int
+                      , unsigned int, unsigned int
+                      , const MbTileCallback&, const MbTilesBulkOptions&)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+bool loadMbTiles(const std::string&, unsigned int
+                 , const std::vector<std::pair<unsigned int, unsigned int>>&
+                 , const MbTileCallback&, const MbTilesBulkOptions&)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
+bool saveToMbTilesArchive(const std::string&, const char*)
+{
+    ::CPLError(CE_Failure, CPLE_NotSupported
+               , "mbtiles unsupported: gdal-drivers compiled "
+               "without Sqlite3 support");
+    return false;
+}
+
 } } // namespace gdal_drivers::detail
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <stdexcept>
+
+#include "utility/raise.hpp"
+
+#include "overviews.hpp"
+
+namespace gdal_drivers { namespace detail {
+
+namespace {
+
+/** Registry of pregenerated constant blocks. Block lives as long as anybody
+ *  uses it.
+ */
+class ConstantBlocks {
+public:
+    typedef std::shared_ptr<const void> pointer;
+
+    pointer get(::GDALDataType type, double value, std::size_t count);
+
+    static ConstantBlocks& instance() {
+        static ConstantBlocks blocks;
+        return blocks;
+    }
+
+private:
+    typedef std::tuple<int, std::uint64_t, std::size_t> Key;
+
+    std::mutex mutex_;
+    std::map<Key, std::weak_ptr<const void> > blocks_;
+};
+
+ConstantBlocks::pointer ConstantBlocks::get(::GDALDataType type
+                                            , double value
+                                            , std::size_t count)
+{
+    const auto typeSize(::GDALGetDataTypeSizeBytes(type));
+    if (typeSize <= 0) {
+        utility::raise<std::runtime_error>
+            ("Unsupported data type <%s>.", type);
+    }
+
+    // key by exact value bits
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const Key key(type, bits, count);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    {
+        auto fblocks(blocks_.find(key));
+        if (fblocks != blocks_.end()) {
+            if (auto block = fblocks->second.lock()) { return block; }
+        }
+    }
+
+    // miss: drop blocks nobody uses anymore to keep the registry bounded by
+    // the number of live blocks
+    for (auto iblocks(blocks_.begin()); iblocks != blocks_.end(); ) {
+        if (iblocks->second.expired()) {
+            iblocks = blocks_.erase(iblocks);
+        } else {
+            ++iblocks;
+        }
+    }
+
+    // let GDAL convert value to target type (clamping and rounding) and
+    // broadcast it over the whole block
+    auto *data(new GByte[count * typeSize]);
+    ::GDALCopyWords(&value, ::GDT_Float64, 0, data, type, typeSize, count);
+
+    pointer block(data, [](const void *data) {
+            delete [] static_cast<const GByte*>(data);
+        });
+    blocks_[key] = block;
+    return block;
+}
+
+} // namespace
+
+std::vector<math::Size2> overviewSizes(const math::Size2 &size
+                                       , const math::Size2 &blockSize)
+{
+    std::vector<math::Size2> sizes;
+
+    // add next level while previous one is larger than a block
+    for (long factor(2); ; factor *= 2) {
+        const auto previous(overviewSize(size, factor / 2));
+        if (((previous.width <= blockSize.width)
+             && (previous.height <= blockSize.height))
+            || ((previous.width <= 1) && (previous.height <= 1)))
+        {
+            break;
+        }
+        sizes.push_back(overviewSize(size, factor));
+    }
+
+    return sizes;
+}
+
+std::shared_ptr<const void> constantBlock(::GDALDataType type, double value
+                                          , std::size_t count)
+{
+    return ConstantBlocks::instance().get(type, value, count);
+}
+
+} } // namespace gdal_drivers::detail
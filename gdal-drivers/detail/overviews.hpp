@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef gdal_drivers_detail_overviews_hpp_included_
+#define gdal_drivers_detail_overviews_hpp_included_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <gdal_priv.h>
+
+#include "math/geometry_core.hpp"
+
+namespace gdal_drivers { namespace detail {
+
+/** Size of overview with given decimation factor, rounded up the same way
+ *  GDAL does.
+ */
+inline math::Size2 overviewSize(const math::Size2 &size, long factor)
+{
+    return math::Size2((size.width + factor - 1) / factor
+                       , (size.height + factor - 1) / factor);
+}
+
+/** Sizes of overview levels with factors 2, 4, 8, ... Levels are generated
+ *  (like gdaladdo does) until the last one fits into single block.
+ */
+std::vector<math::Size2> overviewSizes(const math::Size2 &size
+                                       , const math::Size2 &blockSize);
+
+/** Returns block of count pixels of given data type filled with value
+ *  (converted by GDAL rules). Blocks are shared among all users asking for
+ *  the same type, value and pixel count.
+ *
+ *  Throws std::runtime_error on unsupported data type.
+ */
+std::shared_ptr<const void> constantBlock(::GDALDataType type, double value
+                                          , std::size_t count);
+
+/** Overview bands owned by their full-resolution band (or dataset).
+ */
+class OverviewBands {
+public:
+    void add(std::unique_ptr< ::GDALRasterBand> band) {
+        bands_.push_back(std::move(band));
+    }
+
+    int count() const { return bands_.size(); }
+
+    ::GDALRasterBand* get(int index) const {
+        if ((index < 0) || (index >= count())) { return nullptr; }
+        return bands_[index].get();
+    }
+
+private:
+    std::vector<std::unique_ptr< ::GDALRasterBand> > bands_;
+};
+
+} } // namespace gdal_drivers::detail
+
+#endif // gdal_drivers_detail_overviews_hpp_included_
@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef gdal_drivers_detail_prefetcher_hpp_included_
+#define gdal_drivers_detail_prefetcher_hpp_included_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+namespace gdal_drivers { namespace detail {
+
+/** Ordered bounded parallel pipeline.
+ *
+ *  Inputs are produced one by one by fetch (serialized, called under lock),
+ *  processed in parallel by worker threads and handed out by next() in the
+ *  original order. At most lookahead inputs are in flight or waiting to be
+ *  consumed at any time.
+ *
+ *  Fetch returns false when there is no more input. Neither fetch nor
+ *  process should throw; exception thrown by fetch ends the input, exception
+ *  thrown by process leaves output default constructed.
+ */
+template <typename Input, typename Output>
+class Prefetcher {
+public:
+    typedef std::function<bool(Input&)> Fetch;
+    typedef std::function<void(const Input&, Output&)> Process;
+
+    Prefetcher(const Fetch &fetch, const Process &process
+               , unsigned int threads, unsigned int lookahead)
+        : fetch_(fetch), process_(process)
+        , lookahead_(std::max(lookahead, 1u))
+        , fetched_(), consumed_(), eof_(false), stop_(false)
+    {
+        threads = std::max(threads, 1u);
+        threads_.reserve(threads);
+        for (unsigned int i(0); i < threads; ++i) {
+            threads_.emplace_back(&Prefetcher::worker, this);
+        }
+    }
+
+    ~Prefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (auto &thread : threads_) { thread.join(); }
+    }
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    /** Returns next output in input order. Returns false at the end.
+     */
+    bool next(Output &output) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() {
+                return (ready_.count(consumed_)
+                        || (eof_ && (consumed_ >= fetched_)));
+            });
+
+        auto iready(ready_.find(consumed_));
+        if (iready == ready_.end()) { return false; }
+
+        output = std::move(iready->second);
+        ready_.erase(iready);
+        ++consumed_;
+
+        // window moved, let workers fetch more
+        lock.unlock();
+        cond_.notify_all();
+        return true;
+    }
+
+private:
+    void worker() {
+        for (;;) {
+            Input input;
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this]() {
+                        return (stop_ || eof_
+                                || (fetched_ < (consumed_ + lookahead_)));
+                    });
+                if (stop_ || eof_) { return; }
+
+                bool ok(false);
+                try { ok = fetch_(input); } catch (...) {}
+
+                if (!ok) {
+                    eof_ = true;
+                    lock.unlock();
+                    cond_.notify_all();
+                    return;
+                }
+                index = fetched_++;
+            }
+
+            Output output;
+            try { process_(input, output); } catch (...) { output = {}; }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ready_.emplace(index, std::move(output));
+            }
+            cond_.notify_all();
+        }
+    }
+
+    Fetch fetch_;
+    Process process_;
+    const std::size_t lookahead_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+
+    /** Number of fetched inputs, i.e. index of next input.
+     */
+    std::size_t fetched_;
+
+    /** Index of next output to hand out.
+     */
+    std::size_t consumed_;
+
+    bool eof_;
+    bool stop_;
+
+    /** Processed outputs waiting to be consumed.
+     */
+    std::map<std::size_t, Output> ready_;
+
+    std::vector<std::thread> threads_;
+};
+
+} } // namespace gdal_drivers::detail
+
+#endif // gdal_drivers_detail_prefetcher_hpp_included_
@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <cpl_error.h>
+#include <cpl_vsi.h>
+
+#include "tilepresence.hpp"
+
+namespace gdal_drivers { namespace detail {
+
+namespace {
+
+const char Magic[8] = { 'M', 'B', 'T', 'P', 'R', 'E', 'S', '1' };
+
+/** Closes VSI file on scope exit.
+ */
+struct File {
+    File(::VSILFILE *f) : f(f) {}
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File() { if (f) { ::VSIFCloseL(f); } }
+    ::VSILFILE *f;
+};
+
+template <typename T>
+bool write(::VSILFILE *f, const T &value)
+{
+    return ::VSIFWriteL(&value, sizeof(value), 1, f) == 1;
+}
+
+template <typename T>
+bool read(::VSILFILE *f, T &value)
+{
+    return ::VSIFReadL(&value, sizeof(value), 1, f) == 1;
+}
+
+} // namespace
+
+void TilePresence::set(unsigned int zoom, unsigned int col, unsigned int row)
+{
+    auto &word(chunks_[chunkKey(zoom, col, row)][row & 63]);
+    const auto bit(std::uint64_t(1) << (col & 63));
+    if (!(word & bit)) {
+        word |= bit;
+        ++count_;
+    }
+}
+
+bool TilePresence::save(const std::string &path, const Stamp &stamp) const
+{
+    // written to temporary file first, readers never see partial index
+    const auto tmp(path + ".tmp");
+    {
+        File file(::VSIFOpenL(tmp.c_str(), "wb"));
+        if (!file.f) {
+            ::CPLError(CE_Warning, CPLE_FileIO
+                       , "Unable to create tile index <%s>.", tmp.c_str());
+            return false;
+        }
+
+        bool ok(::VSIFWriteL(Magic, sizeof(Magic), 1, file.f) == 1);
+        ok = ok && write(file.f, stamp.size) && write(file.f, stamp.mtime)
+            && write(file.f, std::uint64_t(chunks_.size()));
+        for (const auto &item : chunks_) {
+            if (!ok) { break; }
+            ok = write(file.f, item.first) && write(file.f, item.second);
+        }
+
+        if (!ok) {
+            ::CPLError(CE_Warning, CPLE_FileIO
+                       , "Unable to write tile index <%s>.", tmp.c_str());
+            ::VSIFCloseL(file.f);
+            file.f = nullptr;
+            ::VSIUnlink(tmp.c_str());
+            return false;
+        }
+    }
+
+    if (::VSIRename(tmp.c_str(), path.c_str())) {
+        ::CPLError(CE_Warning, CPLE_FileIO
+                   , "Unable to move tile index to <%s>.", path.c_str());
+        ::VSIUnlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<TilePresence>
+TilePresence::load(const std::string &path, const Stamp &stamp)
+{
+    File file(::VSIFOpenL(path.c_str(), "rb"));
+    if (!file.f) { return {}; }
+
+    char magic[sizeof(Magic)];
+    Stamp fileStamp;
+    std::uint64_t chunkCount;
+    if ((::VSIFReadL(magic, sizeof(magic), 1, file.f) != 1)
+        || std::memcmp(magic, Magic, sizeof(Magic))
+        || !read(file.f, fileStamp.size) || !read(file.f, fileStamp.mtime)
+        || !read(file.f, chunkCount))
+    {
+        return {};
+    }
+
+    // index of another archive (or of its older version)
+    if ((fileStamp.size != stamp.size) || (fileStamp.mtime != stamp.mtime)) {
+        return {};
+    }
+
+    // chunk count must match file size, do not trust it blindly
+    {
+        const auto offset(::VSIFTellL(file.f));
+        ::VSIStatBufL st;
+        if (::VSIStatL(path.c_str(), &st) || (st.st_size < 0)
+            || (std::uint64_t(st.st_size) < offset)
+            || (chunkCount != ((std::uint64_t(st.st_size) - offset)
+                               / (sizeof(std::uint64_t) + sizeof(Chunk)))))
+        {
+            return {};
+        }
+    }
+
+    std::unique_ptr<TilePresence> presence(new TilePresence());
+    presence->chunks_.reserve(chunkCount);
+    for (std::uint64_t i(0); i < chunkCount; ++i) {
+        std::uint64_t key;
+        Chunk chunk;
+        if (!read(file.f, key) || !read(file.f, chunk)) { return {}; }
+
+        for (auto word : chunk) {
+            for (; word; word &= word - 1) { ++presence->count_; }
+        }
+        presence->chunks_.emplace(key, chunk);
+    }
+
+    return presence;
+}
+
+} } // namespace gdal_drivers::detail
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef gdal_drivers_detail_tilepresence_hpp_included_
+#define gdal_drivers_detail_tilepresence_hpp_included_
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace gdal_drivers { namespace detail {
+
+/** Sparse bitmap of existing tiles over all zoom levels (0-30).
+ *
+ *  Tile space of each zoom is split into 64x64 tile chunks; only chunks
+ *  containing at least one tile are stored. Lookup is O(1).
+ */
+class TilePresence {
+public:
+    typedef std::shared_ptr<const TilePresence> pointer;
+
+    /** Archive file identification; persisted index is valid only for the
+     *  same file.
+     */
+    struct Stamp {
+        std::uint64_t size;
+        std::int64_t mtime;
+
+        Stamp() : size(), mtime() {}
+    };
+
+    TilePresence() : count_() {}
+
+    void set(unsigned int zoom, unsigned int col, unsigned int row);
+
+    bool has(unsigned int zoom, unsigned int col, unsigned int row) const;
+
+    /** Number of present tiles.
+     */
+    std::size_t count() const { return count_; }
+
+    /** Saves index to file. Returns false on failure (reported as
+     *  warning via CPLError).
+     */
+    bool save(const std::string &path, const Stamp &stamp) const;
+
+    /** Loads index from file. Returns null pointer if file cannot be read or
+     *  has been built for another file (different stamp).
+     */
+    static std::unique_ptr<TilePresence>
+    load(const std::string &path, const Stamp &stamp);
+
+private:
+    typedef std::array<std::uint64_t, 64> Chunk;
+
+    static std::uint64_t chunkKey(unsigned int zoom, unsigned int col
+                                  , unsigned int row)
+    {
+        return ((std::uint64_t(zoom) << 48) | (std::uint64_t(col >> 6) << 24)
+                | std::uint64_t(row >> 6));
+    }
+
+    std::unordered_map<std::uint64_t, Chunk> chunks_;
+    std::size_t count_;
+};
+
+inline bool TilePresence::has(unsigned int zoom, unsigned int col
+                              , unsigned int row) const
+{
+    auto fchunks(chunks_.find(chunkKey(zoom, col, row)));
+    if (fchunks == chunks_.end()) { return false; }
+    return (fchunks->second[row & 63] >> (col & 63)) & 1;
+}
+
+} } // namespace gdal_drivers::detail
+
+#endif // gdal_drivers_detail_tilepresence_hpp_included_
@@ -76,14 +76,11 @@ public:
     virtual GDALColorInterp GetColorInterpretation() { return GCI_GrayIndex; }
 
     virtual int GetOverviewCount() {
-        const auto &overviews(static_cast<MaskDataset*>(poDS)->overviews_);
-        return overviews.size();
+        return static_cast<MaskDataset*>(poDS)->overviews_.count();
     }
 
     virtual GDALRasterBand* GetOverview(int index) {
-        const auto &overviews(static_cast<MaskDataset*>(poDS)->overviews_);
-        if (index >= int(overviews.size())) { return nullptr; }
-        return overviews[index].get();
+        return static_cast<MaskDataset*>(poDS)->overviews_.get(index);
     }
 
 private:
@@ -170,7 +167,8 @@ MaskDataset::MaskDataset(const fs::path &path, std::ifstream &f)
     auto depth(mask_.depth());
     while (depth) {
         --depth;
-        overviews_.push_back(std::make_shared<RasterBand>(this, depth));
+        overviews_.add(std::unique_ptr<GDALRasterBand>
+                       (new RasterBand(this, depth)));
     }
 }
 
@@ -206,8 +204,10 @@ MaskDataset::RasterBand::RasterBand(MaskDataset *dset, unsigned int depth)
     nBlockYSize = dset->tileSize_.height;
     eDataType = GDT_Byte;
 
-    nRasterXSize = dset->mask_.size().width >> tail_;
-    nRasterYSize = dset->mask_.size().height >> tail_;
+    // level size rounded up as GDAL expects it
+    const auto size(detail::overviewSize(dset->mask_.size(), 1l << tail_));
+    nRasterXSize = size.width;
+    nRasterYSize = size.height;
 }
 
 namespace color {
@@ -46,6 +46,8 @@
 #include "imgproc/rastermask/mappedqtree.hpp"
 #include "geo/srsdef.hpp"
 
+#include "detail/overviews.hpp"
+
 namespace fs = boost::filesystem;
 
 namespace gdal_drivers {
@@ -86,8 +88,9 @@ private:
     math::Extents2 extents_;
     math::Size2 tileSize_;
 
-    typedef std::vector<std::shared_ptr<RasterBand> > RasterBands;
-    RasterBands overviews_;
+    /** Overview bands, one per quadtree level above the bottom one.
+     */
+    detail::OverviewBands overviews_;
 };
 
 } // namespace gdal_drivers
@@ -0,0 +1,582 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*
+ * @file mbtilesraster.cpp
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <atomic>
+#include <algorithm>
+#include <map>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <cpl_vsi.h>
+
+#include "dbglog/dbglog.hpp"
+
+#include "geo/srsdef.hpp"
+
+#include "detail/mbtiles.hpp"
+
+#include "mbtilesraster.hpp"
+
+namespace ba = boost::algorithm;
+
+namespace gdal_drivers {
+
+namespace {
+
+const char *webMercatorSrs
+    ("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0"
+     " +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
+
+const double webMercatorHalf(20037508.342789244);
+
+bool isRasterFormat(const std::string &format)
+{
+    return ((format == "png") || (format == "jpg") || (format == "jpeg")
+            || (format == "webp"));
+}
+
+/** Reads archive metadata. Returns false if archive is not a raster one.
+ */
+bool rasterMetadata(const char *path
+                    , std::map<std::string, std::string> &metadata)
+{
+    if (!ba::iends_with(path, ".mbtiles")) { return false; }
+
+    ::CPLPushErrorHandler(::CPLQuietErrorHandler);
+    const bool ok(detail::readMbTilesMetadata(path, metadata));
+    ::CPLPopErrorHandler();
+    if (!ok) { return false; }
+
+    auto fmetadata(metadata.find("format"));
+    return ((fmetadata != metadata.end())
+            && isRasterFormat(fmetadata->second));
+}
+
+/** Tile range covering given bounds (degrees) at given zoom.
+ */
+struct TileRange {
+    int colMin;
+    int rowMin;
+    int colMax;
+    int rowMax;
+
+    TileRange(double w, double s, double e, double n, unsigned int zoom)
+    {
+        const double tiles(1u << zoom);
+        const int max((1 << zoom) - 1);
+
+        const auto clamp([max](double value) -> int
+        {
+            value = std::floor(value);
+            if (value < 0) { return 0; }
+            if (value > max) { return max; }
+            return int(value);
+        });
+
+        const auto x([&](double lon) {
+            return clamp((lon + 180.0) / 360.0 * tiles);
+        });
+
+        const auto y([&](double lat) -> int {
+            lat = std::max(-85.0511287798, std::min(85.0511287798, lat));
+            const auto rad(lat * M_PI / 180.0);
+            return clamp((1.0 - std::log(std::tan(rad) + 1.0 / std::cos(rad))
+                          / M_PI) / 2.0 * tiles);
+        });
+
+        colMin = x(w);
+        colMax = x(e);
+        rowMin = y(n);
+        rowMax = y(s);
+    }
+};
+
+/** Image opened from memory by GDAL image drivers. Data must outlive the
+ *  image.
+ */
+class MemImage {
+public:
+    MemImage(const std::string &data)
+        : path_(::CPLSPrintf("/vsimem/mbtilesraster/%p-%lu"
+                             , static_cast<const void*>(this), counter()++))
+        , ds_()
+    {
+        // wrap data without copying
+        auto *f(::VSIFileFromMemBuffer
+                (path_.c_str()
+                 , reinterpret_cast< ::GByte*>(const_cast<char*>(data.data()))
+                 , data.size(), false));
+        if (!f) { return; }
+        ::VSIFCloseL(f);
+
+        const char *const drivers[] = { "PNG", "JPEG", "WEBP", nullptr };
+        ds_ = ::GDALOpenEx(path_.c_str(), GDAL_OF_RASTER | GDAL_OF_INTERNAL
+                           , drivers, nullptr, nullptr);
+    }
+
+    ~MemImage() {
+        if (ds_) { ::GDALClose(ds_); }
+        ::VSIUnlink(path_.c_str());
+    }
+
+    MemImage(const MemImage&) = delete;
+    MemImage& operator=(const MemImage&) = delete;
+
+    /** Opened dataset, null pointer on failure.
+     */
+    ::GDALDataset* get() const { return static_cast< ::GDALDataset*>(ds_); }
+
+private:
+    static std::atomic<unsigned long>& counter() {
+        static std::atomic<unsigned long> counter(0);
+        return counter;
+    }
+
+    const std::string path_;
+    ::GDALDatasetH ds_;
+};
+
+/** Detects tile size: metadata "tilesize" first, then size of first tile
+ *  found at given zoom. Returns zero if neither is available.
+ */
+int detectTileSize(const std::string &archive
+                   , const std::map<std::string, std::string> &metadata
+                   , unsigned int zoom)
+{
+    auto fmetadata(metadata.find("tilesize"));
+    if (fmetadata != metadata.end()) {
+        const int size(std::atoi(fmetadata->second.c_str()));
+        if (size > 0) { return size; }
+    }
+
+    ::CPLPushErrorHandler(::CPLQuietErrorHandler);
+    int size(0);
+    try {
+        const unsigned int max((1u << zoom) - 1);
+        detail::MbTilesCursor cursor(archive, zoom, 0, 0, max, max, false);
+        unsigned int col, row;
+        std::string data;
+        if (cursor.valid() && cursor.next(col, row, data)) {
+            const MemImage image(data);
+            if (auto *ds = image.get()) {
+                if (ds->GetRasterXSize() == ds->GetRasterYSize()) {
+                    size = ds->GetRasterXSize();
+                }
+            }
+        }
+    } catch (...) {}
+    ::CPLPopErrorHandler();
+
+    return size;
+}
+
+} // namespace
+
+class MbTilesRasterDataset::RasterBand : public ::GDALRasterBand {
+public:
+    RasterBand(MbTilesRasterDataset *dset, int band, std::size_t level);
+
+    virtual CPLErr IReadBlock(int blockCol, int blockRow, void *image);
+
+    virtual GDALColorInterp GetColorInterpretation() {
+        switch (nBand) {
+        case 1: return GCI_RedBand;
+        case 2: return GCI_GreenBand;
+        case 3: return GCI_BlueBand;
+        default: return GCI_AlphaBand;
+        }
+    }
+
+    virtual int GetOverviewCount() { return ovrBands_.size(); }
+
+    virtual GDALRasterBand* GetOverview(int index) {
+        if ((index < 0) || (index >= int(ovrBands_.size()))) {
+            return nullptr;
+        }
+        return ovrBands_[index].get();
+    }
+
+private:
+    MbTilesRasterDataset &dset_;
+    std::size_t level_;
+
+    /** Overview bands, only in full resolution band.
+     */
+    std::vector<std::unique_ptr<RasterBand>> ovrBands_;
+};
+
+MbTilesRasterDataset::RasterBand::RasterBand(MbTilesRasterDataset *dset
+                                             , int band, std::size_t level)
+    : dset_(*dset), level_(level)
+{
+    const auto &l(dset_.levels_[level_]);
+    poDS = dset;
+    nBand = band;
+    nBlockXSize = nBlockYSize = dset_.tileSize_;
+    eDataType = GDT_Byte;
+    nRasterXSize = l.width;
+    nRasterYSize = l.height;
+
+    if (!level_) {
+        for (std::size_t i(1); i < dset_.levels_.size(); ++i) {
+            ovrBands_.emplace_back(new RasterBand(dset, band, i));
+        }
+    }
+}
+
+CPLErr MbTilesRasterDataset::RasterBand::IReadBlock(int blockCol, int blockRow
+                                                    , void *image)
+{
+    const auto &level(dset_.levels_[level_]);
+    const std::size_t planeSize(nBlockXSize * nBlockYSize);
+
+    bool error(false);
+    const auto pixels(dset_.tile(level, level.col + blockCol
+                                 , level.row + blockRow, error));
+    if (error) { return CE_Failure; }
+
+    if (!pixels) {
+        // missing tile -> transparent
+        std::memset(image, 0, planeSize);
+        return CE_None;
+    }
+
+    std::memcpy(image, pixels->data() + (nBand - 1) * planeSize, planeSize);
+    return CE_None;
+}
+
+int MbTilesRasterDataset::Identify(::GDALOpenInfo *openInfo)
+{
+    std::map<std::string, std::string> metadata;
+    return rasterMetadata(openInfo->pszFilename, metadata);
+}
+
+::GDALDataset* MbTilesRasterDataset::Open(::GDALOpenInfo *openInfo)
+{
+    ::CPLErrorReset();
+
+    std::map<std::string, std::string> metadata;
+    if (!rasterMetadata(openInfo->pszFilename, metadata)) { return nullptr; }
+    const std::string archive(openInfo->pszFilename);
+
+    if (openInfo->eAccess == GA_Update) {
+        CPLError(CE_Failure, CPLE_NotSupported,
+                 "The MBTiles raster driver does not support update "
+                 "access to existing datasets.\n");
+        return nullptr;
+    }
+
+    const auto options(openInfo->papszOpenOptions);
+    if (auto readOptions = detail::MbTilesReadOptions::parse(options)) {
+        detail::configureMbTilesArchive(archive, *readOptions);
+    }
+
+    const std::size_t cacheSize
+        (std::strtoull(::CSLFetchNameValueDef(options, "CACHE_SIZE"
+                                              , "16777216")
+                       , nullptr, 10));
+
+    // zoom range, from metadata or from tiles
+    unsigned int minZoom(0), maxZoom(0);
+    {
+        auto fmin(metadata.find("minzoom"));
+        auto fmax(metadata.find("maxzoom"));
+        if ((fmin != metadata.end()) && (fmax != metadata.end())) {
+            minZoom = std::atoi(fmin->second.c_str());
+            maxZoom = std::atoi(fmax->second.c_str());
+        } else if (!detail::mbTilesZoomRange(archive, minZoom, maxZoom)) {
+            return nullptr;
+        }
+    }
+
+    if ((maxZoom > 30) || (minZoom > maxZoom)) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "MbTilesRasterDataset initialization failure: "
+                 "invalid zoom range %u-%u.\n", minZoom, maxZoom);
+        return nullptr;
+    }
+
+    // tile size: explicit, detected from archive or default
+    int tileSize(256);
+    if (const char *value = ::CSLFetchNameValue(options, "TILE_SIZE")) {
+        tileSize = std::atoi(value);
+        if (tileSize <= 0) {
+            CPLError(CE_Failure, CPLE_IllegalArg
+                     , "MbTilesRasterDataset initialization failure: "
+                     "invalid TILE_SIZE.\n");
+            return nullptr;
+        }
+    } else if (const auto detected
+               = detectTileSize(archive, metadata, maxZoom))
+    {
+        tileSize = detected;
+    }
+
+    // bounds, whole world by default
+    double w(-180.0), s(-85.0511287798), e(180.0), n(85.0511287798);
+    {
+        auto fbounds(metadata.find("bounds"));
+        if (fbounds != metadata.end()) {
+            double bw, bs, be, bn;
+            if (std::sscanf(fbounds->second.c_str(), "%lf,%lf,%lf,%lf"
+                            , &bw, &bs, &be, &bn) == 4)
+            {
+                w = bw; s = bs; e = be; n = bn;
+            }
+        }
+    }
+
+    // align to tiles of lowest zoom level that keeps raster size in int
+    // range; levels below are not exposed
+    Level::list levels;
+    for (auto zoom(minZoom); zoom <= maxZoom; ++zoom) {
+        const TileRange range(w, s, e, n, zoom);
+        const auto depth(maxZoom - zoom);
+        const double width(double(range.colMax - range.colMin + 1)
+                           * double(1u << depth) * tileSize);
+        const double height(double(range.rowMax - range.rowMin + 1)
+                            * double(1u << depth) * tileSize);
+        if ((width > std::numeric_limits<int>::max())
+            || (height > std::numeric_limits<int>::max()))
+        {
+            continue;
+        }
+
+        for (unsigned int d(0); d <= depth; ++d) {
+            const auto scale(1 << (depth - d));
+            levels.push_back
+                ({ maxZoom - d, range.colMin * scale, range.rowMin * scale
+                   , (range.colMax - range.colMin + 1) * scale * tileSize
+                   , (range.rowMax - range.rowMin + 1) * scale * tileSize });
+        }
+        break;
+    }
+
+    if (levels.empty()) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "MbTilesRasterDataset initialization failure: "
+                 "raster too large.\n");
+        return nullptr;
+    }
+
+    return new MbTilesRasterDataset(archive, levels, tileSize, cacheSize);
+}
+
+MbTilesRasterDataset::MbTilesRasterDataset(const std::string &archive
+                                           , const Level::list &levels
+                                           , int tileSize
+                                           , std::size_t cacheSize)
+    : SrsHoldingDataset(geo::SrsDefinition::fromString(webMercatorSrs))
+    , archive_(archive), levels_(levels), tileSize_(tileSize)
+    , cache_(cacheSize), aliases_(cacheSize / 16)
+{
+    const auto &base(levels_.front());
+    nRasterXSize = base.width;
+    nRasterYSize = base.height;
+
+    // spherical mercator tile grid
+    const double pixel(2.0 * webMercatorHalf
+                       / (double(1u << base.zoom) * tileSize_));
+    geoTransform_[0] = -webMercatorHalf + base.col * tileSize_ * pixel;
+    geoTransform_[1] = pixel;
+    geoTransform_[2] = 0.0;
+    geoTransform_[3] = webMercatorHalf - base.row * tileSize_ * pixel;
+    geoTransform_[4] = 0.0;
+    geoTransform_[5] = -pixel;
+
+    for (int i(1); i <= 4; ++i) {
+        SetBand(i, new RasterBand(this, i, 0));
+    }
+
+    SetDescription(archive_.c_str());
+}
+
+MbTilesRasterDataset::~MbTilesRasterDataset() {}
+
+CPLErr MbTilesRasterDataset::GetGeoTransform(double *padfTransform)
+{
+    std::copy(geoTransform_, geoTransform_ + 6, padfTransform);
+    return CE_None;
+}
+
+std::shared_ptr<const MbTilesRasterDataset::Pixels>
+MbTilesRasterDataset::tile(const Level &level, int col, int row, bool &error)
+{
+    // tiles of plain archives are cached by position
+    std::string key(std::to_string(level.zoom) + "/" + std::to_string(col)
+                    + "/" + std::to_string(row));
+    if (auto pixels = cache_.get(key)) { return pixels; }
+
+    // known position in deduplicated archive: no need to touch database
+    if (auto tileId = aliases_.get(key)) {
+        if (auto pixels = cache_.get("#" + *tileId)) { return pixels; }
+    }
+
+    std::string data;
+    std::string tileId;
+    if (!detail::readMbTileData(archive_, level.zoom, col, row, data, false
+                                , &tileId))
+    {
+        return {};
+    }
+
+    // tiles of deduplicated archive are cached by tile_id: all tiles
+    // sharing one image are decoded once
+    if (!tileId.empty()) {
+        aliases_.put(key, std::make_shared<const std::string>(tileId)
+                     , key.size() + tileId.size());
+        key = "#" + tileId;
+        if (auto pixels = cache_.get(key)) { return pixels; }
+    }
+
+    auto pixels(decode(data));
+    if (!pixels) {
+        error = true;
+        return {};
+    }
+
+    cache_.put(key, pixels, pixels->size());
+    return pixels;
+}
+
+std::shared_ptr<const MbTilesRasterDataset::Pixels>
+MbTilesRasterDataset::decode(const std::string &data)
+{
+    const MemImage image(data);
+    if (!image.get()) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "Unable to decode tile from <%s>.", archive_.c_str());
+        return {};
+    }
+
+    auto &src(*image.get());
+    const auto bands(src.GetRasterCount());
+    if ((src.GetRasterXSize() != tileSize_)
+        || (src.GetRasterYSize() != tileSize_) || !bands)
+    {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "Unexpected tile size %dx%d in <%s> (expected %dx%d)."
+                 , src.GetRasterXSize(), src.GetRasterYSize()
+                 , archive_.c_str(), tileSize_, tileSize_);
+        return {};
+    }
+
+    const std::size_t planeSize(tileSize_ * tileSize_);
+    auto pixels(std::make_shared<Pixels>(4 * planeSize, ::GByte(255)));
+    auto plane([&](int i) { return pixels->data() + i * planeSize; });
+
+    const auto read([&](int band, ::GByte *out) -> bool
+    {
+        return src.GetRasterBand(band)->RasterIO
+            (GF_Read, 0, 0, tileSize_, tileSize_, out
+             , tileSize_, tileSize_, GDT_Byte, 0, 0) == CE_None;
+    });
+
+    if (bands == 1) {
+        if (!read(1, plane(0))) { return {}; }
+
+        if (const auto *ct = src.GetRasterBand(1)->GetColorTable()) {
+            // expand palette
+            const auto count(ct->GetColorEntryCount());
+            auto *r(plane(0)), *g(plane(1)), *b(plane(2)), *a(plane(3));
+            for (std::size_t i(0); i < planeSize; ++i) {
+                const int index(r[i]);
+                if (index >= count) { a[i] = 0; continue; }
+                const auto *entry(ct->GetColorEntry(index));
+                r[i] = entry->c1;
+                g[i] = entry->c2;
+                b[i] = entry->c3;
+                a[i] = entry->c4;
+            }
+        } else {
+            std::memcpy(plane(1), plane(0), planeSize);
+            std::memcpy(plane(2), plane(0), planeSize);
+        }
+    } else if (bands == 2) {
+        // gray + alpha
+        if (!read(1, plane(0)) || !read(2, plane(3))) { return {}; }
+        std::memcpy(plane(1), plane(0), planeSize);
+        std::memcpy(plane(2), plane(0), planeSize);
+    } else {
+        for (int i(0), e(std::min(bands, 4)); i < e; ++i) {
+            if (!read(i + 1, plane(i))) { return {}; }
+        }
+    }
+
+    return pixels;
+}
+
+} // namespace gdal_drivers
+
+/* GDALRegister_MbTilesRasterDataset */
+
+void GDALRegister_MbTilesRasterDataset()
+{
+    if (!GDALGetDriverByName("MbTilesRaster")) {
+        std::unique_ptr<GDALDriver> driver(new GDALDriver());
+
+        driver->SetDescription("MbTilesRaster");
+        driver->SetMetadataItem
+            (GDAL_DMD_LONGNAME
+             , "Raster MBTiles archive as tiled raster with overviews.");
+        driver->SetMetadataItem(GDAL_DMD_EXTENSION, "mbtiles");
+        driver->SetMetadataItem(GDAL_DCAP_RASTER, "YES");
+        driver->SetMetadataItem
+            (GDAL_DMD_OPENOPTIONLIST,
+             "<OpenOptionList>"
+             "  <Option name='TILE_SIZE' type='int' "
+             "description='Tile size in pixels (detected from archive, "
+             "256 if unknown)'/>"
+             "  <Option name='CACHE_SIZE' type='int' default='16777216' "
+             "description='Decoded tile cache size in bytes'/>"
+             "  <Option name='SQLITE_IMMUTABLE' type='boolean' "
+             "description='Open archive as immutable (no locking)'/>"
+             "  <Option name='SQLITE_NOLOCK' type='boolean' "
+             "description='Disable SQLite file locking'/>"
+             "  <Option name='SQLITE_MMAP_SIZE' type='int' "
+             "description='SQLite mmap_size in bytes'/>"
+             "  <Option name='SQLITE_CACHE_SIZE' type='int' "
+             "description='SQLite page cache size in bytes'/>"
+             "  <Option name='TILE_INDEX' type='boolean' "
+             "description='Keep in-memory index of existing tiles'/>"
+             "  <Option name='TILE_INDEX_FILE' type='string' "
+             "description='Sidecar file to persist tile index in'/>"
+             "</OpenOptionList>");
+
+        driver->pfnOpen = gdal_drivers::MbTilesRasterDataset::Open;
+        driver->pfnIdentify = gdal_drivers::MbTilesRasterDataset::Identify;
+
+        GetGDALDriverManager()->RegisterDriver(driver.release());
+    }
+}
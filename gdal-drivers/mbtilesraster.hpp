@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2026 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** mbtilesraster.hpp
+ *
+ * GDAL driver that reads raster (PNG/JPEG/WebP) MBTiles archives.
+ */
+
+#ifndef gdal_drivers_mbtilesraster_hpp_included_
+#define gdal_drivers_mbtilesraster_hpp_included_
+
+#include <gdal_priv.h>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "detail/srsholder.hpp"
+#include "detail/lrucache.hpp"
+
+namespace gdal_drivers {
+
+/** Raster MBTiles archive as tiled RGBA raster.
+ *
+ *  Full resolution is given by the highest zoom level, lower zoom levels
+ *  are exposed as overviews. Every block is one tile. Raster covers
+ *  archive's bounds (metadata "bounds", whole world by default) aligned to
+ *  tiles of the lowest exposed zoom level so that all levels share the same
+ *  extents. Missing tiles are transparent.
+ *
+ *  Open options:
+ *      TILE_SIZE   tile size in pixels (metadata "tilesize" or size of
+ *                  first tile of the highest zoom level, 256 if unknown)
+ *      CACHE_SIZE  decoded tile cache size in bytes (16 MiB by default)
+ *      SQLITE_IMMUTABLE, SQLITE_NOLOCK, SQLITE_MMAP_SIZE, SQLITE_CACHE_SIZE
+ *                  SQLite tuning, see detail::MbTilesReadOptions
+ *      TILE_INDEX, TILE_INDEX_FILE
+ *                  index of existing tiles: blocks of missing tiles are
+ *                  answered without touching the database
+ */
+class MbTilesRasterDataset : public SrsHoldingDataset {
+public:
+    static ::GDALDataset* Open(::GDALOpenInfo *openInfo);
+    static int Identify(::GDALOpenInfo *openInfo);
+
+    virtual ~MbTilesRasterDataset();
+
+    virtual CPLErr GetGeoTransform(double *padfTransform) override;
+
+    /** One zoom level. Tile origin is in XYZ scheme.
+     */
+    struct Level {
+        unsigned int zoom;
+        int col;
+        int row;
+        int width;
+        int height;
+
+        typedef std::vector<Level> list;
+    };
+
+    /** Decoded tile, band-sequential 8-bit RGBA.
+     */
+    typedef std::vector< ::GByte> Pixels;
+
+private:
+    MbTilesRasterDataset(const std::string &archive
+                         , const Level::list &levels, int tileSize
+                         , std::size_t cacheSize);
+
+    class RasterBand;
+    friend class RasterBand;
+
+    /** Returns decoded tile from given level, null pointer if tile is
+     *  missing. Sets error flag on decoding failure.
+     */
+    std::shared_ptr<const Pixels> tile(const Level &level, int col, int row
+                                       , bool &error);
+
+    std::shared_ptr<const Pixels> decode(const std::string &data);
+
+    std::string archive_;
+    Level::list levels_;
+    int tileSize_;
+    double geoTransform_[6];
+
+    /** Decoded tiles keyed by "zoom/column/row", or by "#tile_id" in
+     *  deduplicated archives.
+     */
+    detail::LruCache<std::string, Pixels> cache_;
+
+    /** Tile positions ("zoom/column/row") mapped to tile_id in deduplicated
+     *  archives, lets cached tiles be found without querying the archive.
+     */
+    detail::LruCache<std::string, std::string> aliases_;
+};
+
+} // namespace gdal_drivers
+
+// driver registration function
+CPL_C_START
+void GDALRegister_MbTilesRasterDataset(void);
+CPL_C_END
+
+#endif // gdal_drivers_mbtilesraster_hpp_included_
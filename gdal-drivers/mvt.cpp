@@ -28,20 +28,42 @@
  */
 
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <limits>
 #include <algorithm>
 #include <vector>
 #include <iterator>
+#include <functional>
 #include <fstream>
 #include <iomanip>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <string>
+#include <thread>
+#include <type_traits>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/find.hpp>
+#include <boost/algorithm/string/replace.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <ogrsf_frmts.h>
-#include <cpl_http.h>
+#include <ogr_swq.h>
+#include <cpl_vsi.h>
 
 #include "dbglog/dbglog.hpp"
 
+#include "jsoncpp/json.hpp"
+
 #include "utility/raise.hpp"
 #include "utility/multivalue.hpp"
 #include "utility/streams.hpp"
@@ -52,6 +74,8 @@
 
 #include "mvt.hpp"
 #include "detail/mbtiles.hpp"
+#include "detail/prefetcher.hpp"
+#include "detail/lrucache.hpp"
 
 namespace po = boost::program_options;
 namespace ba = boost::algorithm;
@@ -62,7 +86,11 @@ namespace gdal_drivers {
  */
 class Trafo {
 public:
-    Trafo(double extent, const boost::optional<math::Extents2> &extents) {
+    Trafo(double extent, const boost::optional<math::Extents2> &extents
+          , const std::shared_ptr< ::OGRCoordinateTransformation> &ct
+          = std::shared_ptr< ::OGRCoordinateTransformation>())
+        : ct_(ct)
+    {
         if (extents) {
             // use upper-left corner
             shift_ = math::ul(*extents);
@@ -78,6 +106,12 @@ public:
         }
     }
 
+    /** Plain scale and shift.
+     */
+    Trafo(const math::Point2d &shift, const math::Size2f &scale)
+        : shift_(shift), scale_(scale)
+    {}
+
     inline double x(std::int32_t value) const {
         return value * scale_.width + shift_(0);
     }
@@ -86,26 +120,114 @@ public:
         return value * scale_.height + shift_(1);
     }
 
+    /** Inverse conversion: world coordinates to tile coordinates.
+     */
+    inline double ix(double value) const {
+        return (value - shift_(0)) / scale_.width;
+    }
+
+    inline double iy(double value) const {
+        return (value - shift_(1)) / scale_.height;
+    }
+
+    /** Converts count tile coordinates (stored as doubles) in place. Separate
+     *  passes over contiguous arrays to let the compiler vectorize them.
+     *
+     *  Reprojection (if any) is applied to the same arrays right away.
+     */
+    inline void operator()(std::size_t count, double *x, double *y) const {
+        const auto sx(scale_.width);
+        const auto dx(shift_(0));
+        for (std::size_t i(0); i < count; ++i) { x[i] = x[i] * sx + dx; }
+
+        const auto sy(scale_.height);
+        const auto dy(shift_(1));
+        for (std::size_t i(0); i < count; ++i) { y[i] = y[i] * sy + dy; }
+
+        if (ct_ && count && !ct_->Transform(int(count), x, y)) {
+            LOGTHROW(err1, std::runtime_error)
+                << "Failed to reproject geometry.";
+        }
+    }
+
+    /** Inverse of operator(): world coordinates to tile coordinates.
+     */
+    inline void inverse(std::size_t count, double *x, double *y) const {
+        const auto sx(scale_.width);
+        const auto dx(shift_(0));
+        for (std::size_t i(0); i < count; ++i) { x[i] = (x[i] - dx) / sx; }
+
+        const auto sy(scale_.height);
+        const auto dy(shift_(1));
+        for (std::size_t i(0); i < count; ++i) { y[i] = (y[i] - dy) / sy; }
+    }
+
+    const math::Point2d& shift() const { return shift_; }
+    const math::Size2f& scale() const { return scale_; }
+
+    /** Output is reprojected, i.e. not an affine function of tile space.
+     */
+    bool projected() const { return bool(ct_); }
+
 private:
     math::Point2d shift_;
     math::Size2f scale_;
+    std::shared_ptr< ::OGRCoordinateTransformation> ct_;
+};
+
+/** Contiguous coordinate arrays reused between geometries.
+ */
+struct Coordinates {
+    std::vector<double> x;
+    std::vector<double> y;
+
+    void resize(std::size_t size) { x.resize(size); y.resize(size); }
+};
+
+/** Prefilter for single "field = value" term of an attribute filter.
+ */
+struct ValueFilter {
+    /** Key index in layer's keys table.
+     */
+    std::uint32_t key;
+
+    /** Matching flag for every entry in layer's values table.
+     */
+    std::vector<bool> values;
+
+    typedef std::vector<ValueFilter> list;
+};
+
+/** MVT value decoded once per layer. Tags refer to values by index so
+ *  per-tag work reduces to table lookup and typed store.
+ */
+struct TagValue {
+    enum class Kind : std::uint8_t {
+        unknown, string, real, integer, boolean
+    };
+
+    Kind kind;
+    ::GIntBig integer;
+    double real;
+    const std::string *string;
+
+    TagValue() : kind(Kind::unknown), integer(), real(), string() {}
+
+    typedef std::vector<TagValue> list;
 };
 
 class MvtDataset::Layer : public ::OGRLayer
 {
 public:
-    Layer(MvtDataset &ds, const vector_tile::Tile_Layer &layer)
-        : ds_(ds), layer_(layer)
-        , featureDefn_
-          (::OGRFeatureDefn::CreateFeatureDefn(layer_.name().c_str()))
-        , ifeatures_(layer_.features().begin())
-        , efeatures_(layer_.features().end())
-        , trafo_(layer_.extent(), ds_.extents_)
-    {
-        if (ds_.srs_) {
-            srs_.reset(new ::OGRSpatialReference(ds.srs_->reference()));
-        }
-    }
+    Layer(MvtDataset &ds, const vector_tile::Tile_Layer &layer);
+
+    /** Layer with externally provided schema (shared by several tiles). Keys
+     *  are mapped to fields by name, keys missing in schema are ignored.
+     */
+    Layer(const vector_tile::Tile_Layer &layer, ::OGRFeatureDefn *featureDefn
+          , const Trafo &trafo
+          , const std::shared_ptr< ::OGRSpatialReference> &srs
+          , bool noFields, bool trusted);
 
     virtual ~Layer() {
         featureDefn_->Release();
@@ -115,49 +237,121 @@ public:
     virtual void ResetReading();
     virtual ::OGRFeature* GetNextFeature();
     virtual ::OGRFeatureDefn* GetLayerDefn() { return featureDefn_; }
-    virtual int TestCapability(const char*) { return 0; }
+    virtual int TestCapability(const char *cap);
     virtual const char* GetName() { return layer_.name().c_str(); }
     virtual ::GIntBig GetFeatureCount(int force);
 
+    using ::OGRLayer::GetExtent;
+    virtual ::OGRErr GetExtent(::OGREnvelope *extent, int force);
+
+    using ::OGRLayer::SetSpatialFilter;
+    virtual void SetSpatialFilter(::OGRGeometry *geometry);
+    virtual ::OGRErr SetAttributeFilter(const char *query);
+
+    /** Decodes all features into columns. Throws on invalid geometry.
+     */
+    void read(Columns &columns);
+
 private:
-    MvtDataset &ds_;
-    std::unique_ptr< ::OGRSpatialReference> srs_;
+    /** Builds layer schema from all features' tags.
+     */
+    void buildSchema();
+
+    /** Creates OGR feature from MVT feature. Throws on invalid geometry.
+     */
+    std::unique_ptr< ::OGRFeature>
+    createFeature(const vector_tile::Tile_Feature &feature);
+
+    /** Cheap rejection of features before they are decoded: checks tags
+     *  against value filters and geometry bounding box against spatial
+     *  filter. Returns false if feature cannot pass the filters.
+     */
+    bool prefilter(const vector_tile::Tile_Feature &feature) const;
+
+    std::shared_ptr< ::OGRSpatialReference> srs_;
+    bool noFields_;
+
+    /** Use validation-free geometry decoder.
+     */
+    bool trusted_;
+
     const vector_tile::Tile_Layer &layer_;
     ::OGRFeatureDefn *featureDefn_;
     decltype(layer_.features().begin()) ifeatures_;
     decltype(layer_.features().end()) efeatures_;
     Trafo trafo_;
-};
 
-::GIntBig MvtDataset::Layer::GetFeatureCount(int) {
-    return layer_.features_size();
-}
+    /** Maps key index (in layer's keys table) to field index in featureDefn_,
+     *  -1 for keys not used by any feature.
+     */
+    std::vector<int> keyToField_;
 
-void MvtDataset::Layer::ResetReading()
-{
-    ifeatures_ = layer_.features().begin();
-}
+    /** Index of "id" key, -1 if there is none.
+     */
+    int idKey_;
 
-namespace {
+    /** Layer values decoded once.
+     */
+    TagValue::list values_;
 
-OGRwkbGeometryType type(vector_tile::Tile_GeomType type)
-{
-    switch (type) {
-    case vector_tile::Tile_GeomType::Tile_GeomType_POINT:
-        return ::OGRwkbGeometryType::wkbPoint;
+    /** Coordinate buffer shared by all decoded geometries.
+     */
+    Coordinates coords_;
 
-    case vector_tile::Tile_GeomType::Tile_GeomType_LINESTRING:
-        return ::OGRwkbGeometryType::wkbLineString;
+    /** Spatial filter envelope in tile coordinates.
+     */
+    boost::optional<math::Extents2> tileFilter_;
 
-    case vector_tile::Tile_GeomType::Tile_GeomType_POLYGON:
-        return ::OGRwkbGeometryType::wkbPolygon;
+    /** Prefilters derived from attribute filter.
+     */
+    ValueFilter::list valueFilters_;
 
-    default: break;
+    /** Cached number of valid features, -1 if not computed yet.
+     */
+    ::GIntBig featureCount_;
+
+    /** Cached layer extent.
+     */
+    boost::optional< ::OGREnvelope> extent_;
+};
+
+::GIntBig MvtDataset::Layer::GetFeatureCount(int force) {
+    // filters applied, let OGR iterate
+    if (m_poFilterGeom || m_poAttrQuery) {
+        return ::OGRLayer::GetFeatureCount(force);
     }
 
-    return ::OGRwkbGeometryType::wkbUnknown;
+    if (featureCount_ < 0) {
+        // count only features returned by GetNextFeature
+        featureCount_ = 0;
+        for (const auto &feature : layer_.features()) {
+            if (feature.type()
+                != vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN)
+            {
+                ++featureCount_;
+            }
+        }
+    }
+    return featureCount_;
 }
 
+int MvtDataset::Layer::TestCapability(const char *cap)
+{
+    if (EQUAL(cap, OLCFastSpatialFilter)) { return TRUE; }
+    if (EQUAL(cap, OLCFastGetExtent)) { return !trafo_.projected(); }
+    if (EQUAL(cap, OLCFastFeatureCount)) {
+        return (!m_poFilterGeom && !m_poAttrQuery);
+    }
+    return FALSE;
+}
+
+void MvtDataset::Layer::ResetReading()
+{
+    ifeatures_ = layer_.features().begin();
+}
+
+namespace {
+
 typedef decltype(vector_tile::Tile_Feature().geometry()) MvtGeometry;
 
 struct Cursor {
@@ -198,9 +392,11 @@ std::ostream& operator<<(std::ostream &os, const Command::Type &t)
 
 class GeometryReader : public Trafo {
 public:
-    GeometryReader(const Trafo &trafo, const MvtGeometry &source)
+    GeometryReader(const Trafo &trafo, const MvtGeometry &source
+                   , Coordinates &coords)
         : Trafo(trafo)
         , source_(source), pos_(source_.begin()), end_(source_.end())
+        , coords_(coords)
     {}
 
     ~GeometryReader() {
@@ -214,12 +410,38 @@ public:
     operator bool() const { return pos_ != end_; }
 
     Command command(Command::Type type);
+
+    /** Reads command and checks its count.
+     */
+    Command nonzero(Command::Type type);
+    Command single(Command::Type type);
+
     void shift(Cursor &cursor);
 
+    /** Reads count shifts into coordinate buffer starting at given index.
+     *  Buffer must be already large enough.
+     */
+    void shift(Cursor &cursor, std::size_t index, std::uint32_t count);
+
+    /** Same as above, accumulates doubled signed area (surveyor's formula
+     *  in tile coordinates) of the path being read.
+     */
+    void shift(Cursor &cursor, std::size_t index, std::uint32_t count
+               , std::int64_t &area);
+
+    /** Converts first count coordinates in the buffer into world coordinates.
+     */
+    void transform(std::size_t count) {
+        (*this)(count, coords_.x.data(), coords_.y.data());
+    }
+
+    Coordinates& coords() { return coords_; }
+
 private:
     const MvtGeometry &source_;
     decltype(source_.begin()) pos_;
     decltype(source_.end()) end_;
+    Coordinates &coords_;
 };
 
 inline Command GeometryReader::command(Command::Type type)
@@ -234,6 +456,15 @@ inline Command GeometryReader::command(Command::Type type)
             << "Unexpected type: " << c.type
             << " (expected: " << type << ").";
     }
+
+    // every vertex needs at least two more values: reject bogus counts
+    // before anybody allocates room for them
+    if ((c.type != Command::Type::closePath)
+        && (c.count > std::uint64_t(end_ - pos_) / 2))
+    {
+        LOGTHROW(err1, std::runtime_error)
+            << "Command count " << c.count << " exceeds available input.";
+    }
     return c;
 }
 
@@ -258,6 +489,33 @@ inline void GeometryReader::shift(Cursor &cursor)
     cursor.y += unzigzag(*pos_++);
 }
 
+inline void GeometryReader::shift(Cursor &cursor, std::size_t index
+                                  , std::uint32_t count)
+{
+    auto *x(coords_.x.data() + index);
+    auto *y(coords_.y.data() + index);
+    while (count--) {
+        shift(cursor);
+        *x++ = cursor.x;
+        *y++ = cursor.y;
+    }
+}
+
+inline void GeometryReader::shift(Cursor &cursor, std::size_t index
+                                  , std::uint32_t count, std::int64_t &area)
+{
+    auto *x(coords_.x.data() + index);
+    auto *y(coords_.y.data() + index);
+    while (count--) {
+        const auto prev(cursor);
+        shift(cursor);
+        area += (std::int64_t(prev.x) * cursor.y
+                 - std::int64_t(cursor.x) * prev.y);
+        *x++ = cursor.x;
+        *y++ = cursor.y;
+    }
+}
+
 inline Command checkNonzero(const Command &cmd)
 {
     if (!cmd.count) {
@@ -285,69 +543,272 @@ inline Command checkSingle(const Command &cmd)
     return cmd;
 }
 
-std::unique_ptr< ::OGRGeometry> points(GeometryReader &gr)
+inline Command GeometryReader::nonzero(Command::Type type)
+{
+    return checkNonzero(command(type));
+}
+
+inline Command GeometryReader::single(Command::Type type)
+{
+    return checkSingle(command(type));
+}
+
+/** Geometry reader for trusted input (MVT_TRUSTED). Commands are taken as
+ *  they are, without type and count validation and without exceptions. The
+ *  only check keeps reads within input: every command count (whatever its
+ *  type, callers use count of unexpected command as well) is clipped to the
+ *  available data before any buffer is sized by it, and shift loops stop at
+ *  the end of input.
+ */
+class TrustedGeometryReader : public Trafo {
+public:
+    TrustedGeometryReader(const Trafo &trafo, const MvtGeometry &source
+                          , Coordinates &coords)
+        : Trafo(trafo)
+        , pos_(source.data()), end_(pos_ + source.size())
+        , coords_(coords)
+    {}
+
+    operator bool() const { return pos_ != end_; }
+
+    Command command(Command::Type) {
+        if (pos_ == end_) { return Command(0u); }
+        Command c(*pos_++);
+
+        // never read past the end of input
+        c.count = clip(c.count);
+        return c;
+    }
+
+    Command nonzero(Command::Type type) { return command(type); }
+    Command single(Command::Type type) { return command(type); }
+
+    void shift(Cursor &cursor) {
+        if ((end_ - pos_) < 2) {
+            pos_ = end_;
+            return;
+        }
+        cursor.x += unzigzag(*pos_++);
+        cursor.y += unzigzag(*pos_++);
+    }
+
+    void shift(Cursor &cursor, std::size_t index, std::uint32_t count) {
+        auto *x(coords_.x.data() + index);
+        auto *y(coords_.y.data() + index);
+        count = clip(count);
+        while (count--) {
+            cursor.x += unzigzag(*pos_++);
+            cursor.y += unzigzag(*pos_++);
+            *x++ = cursor.x;
+            *y++ = cursor.y;
+        }
+    }
+
+    void shift(Cursor &cursor, std::size_t index, std::uint32_t count
+               , std::int64_t &area)
+    {
+        auto *x(coords_.x.data() + index);
+        auto *y(coords_.y.data() + index);
+        count = clip(count);
+        while (count--) {
+            const auto prev(cursor);
+            cursor.x += unzigzag(*pos_++);
+            cursor.y += unzigzag(*pos_++);
+            area += (std::int64_t(prev.x) * cursor.y
+                     - std::int64_t(cursor.x) * prev.y);
+            *x++ = cursor.x;
+            *y++ = cursor.y;
+        }
+    }
+
+    void transform(std::size_t count) {
+        (*this)(count, coords_.x.data(), coords_.y.data());
+    }
+
+    Coordinates& coords() { return coords_; }
+
+private:
+    /** Number of points that can be read from the rest of input.
+     */
+    std::uint32_t clip(std::uint32_t count) const {
+        const std::uint32_t available((end_ - pos_) / 2);
+        return (count > available) ? available : count;
+    }
+
+    const std::uint32_t *pos_;
+    const std::uint32_t *end_;
+    Coordinates &coords_;
+};
+
+/** Integer bounding box of geometry in tile coordinates.
+ */
+struct TileBounds {
+    std::int32_t xmin;
+    std::int32_t ymin;
+    std::int32_t xmax;
+    std::int32_t ymax;
+
+    TileBounds()
+        : xmin(std::numeric_limits<std::int32_t>::max())
+        , ymin(std::numeric_limits<std::int32_t>::max())
+        , xmax(std::numeric_limits<std::int32_t>::min())
+        , ymax(std::numeric_limits<std::int32_t>::min())
+    {}
+
+    void update(const Cursor &c) {
+        xmin = std::min(xmin, c.x);
+        ymin = std::min(ymin, c.y);
+        xmax = std::max(xmax, c.x);
+        ymax = std::max(ymax, c.y);
+    }
+
+    void update(const TileBounds &b) {
+        xmin = std::min(xmin, b.xmin);
+        ymin = std::min(ymin, b.ymin);
+        xmax = std::max(xmax, b.xmax);
+        ymax = std::max(ymax, b.ymax);
+    }
+
+    bool valid() const { return xmin <= xmax; }
+};
+
+/** Computes bounds of geometry by walking its command stream without building
+ *  any geometry. Returns false when geometry is empty or malformed, i.e. when
+ *  bounds are not reliable.
+ */
+bool tileBounds(const MvtGeometry &geometry, TileBounds &bounds)
+{
+    Cursor cur;
+    auto pos(geometry.begin());
+    const auto end(geometry.end());
+
+    while (pos != end) {
+        const Command cmd(*pos++);
+        switch (cmd.type) {
+        case Command::Type::moveTo:
+        case Command::Type::lineTo:
+            if ((end - pos) < 2 * std::ptrdiff_t(cmd.count)) { return false; }
+            for (auto count(cmd.count); count; --count) {
+                cur.x += unzigzag(*pos++);
+                cur.y += unzigzag(*pos++);
+                bounds.update(cur);
+            }
+            break;
+
+        case Command::Type::closePath:
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    return bounds.valid();
+}
+
+template <typename Reader>
+std::unique_ptr< ::OGRGeometry> points(Reader &gr)
 {
     Cursor cur;
 
     // moveTo+
     auto moveTo
-        (checkNonzero(gr.command(Command::Type::moveTo)));
+        (gr.nonzero(Command::Type::moveTo));
+
+    // read and convert all points at once
+    auto &coords(gr.coords());
+    coords.resize(moveTo.count);
+    gr.shift(cur, 0, moveTo.count);
+    gr.transform(moveTo.count);
 
     if (moveTo.count == 1) {
         // single point
-        gr.shift(cur);
         return std::unique_ptr< ::OGRPoint>
-            (new ::OGRPoint(gr.x(cur.x), gr.y(cur.y)));
+            (new ::OGRPoint(coords.x[0], coords.y[0]));
     }
 
     // multi point
     std::unique_ptr< ::OGRMultiPoint> g(new ::OGRMultiPoint());
 
     // process all points
-    while (moveTo.count--) {
-        gr.shift(cur);
-        g->addGeometryDirectly(new ::OGRPoint(gr.x(cur.x), gr.y(cur.y)));
+    for (std::uint32_t i(0); i < moveTo.count; ++i) {
+        g->addGeometryDirectly(new ::OGRPoint(coords.x[i], coords.y[i]));
     }
 
     return g;
 }
 
-template <typename Type = ::OGRLineString>
-std::unique_ptr<Type>
-singleLineString(GeometryReader &gr, Cursor &cur, bool closed = false)
+/** Reads moveTo{1} lineTo+ [closePath] sequence into reader's coordinate
+ *  buffer and converts it to world coordinates. Returns number of points.
+ *
+ *  For closed paths, doubled signed area in tile coordinates is stored in
+ *  area (if non-null): positive for exterior rings, negative for interior
+ *  rings and zero for degenerate ones.
+ */
+template <typename Reader>
+std::size_t readPath(Reader &gr, Cursor &cur, bool closed
+                     , std::int64_t *area = nullptr)
 {
-    std::unique_ptr<Type> ls(new Type());
-
     // moveTo{1}
     auto moveTo
-        (checkSingle(gr.command(Command::Type::moveTo)));
+        (gr.single(Command::Type::moveTo));
 
     gr.shift(cur);
-    ls->addPoint(gr.x(cur.x), gr.y(cur.y));
     auto start(cur);
 
     // lineTo+
     auto lineTo
-        (checkNonzero(gr.command(Command::Type::lineTo)));
-
-    while (lineTo.count--) {
-        gr.shift(cur);
-        ls->addPoint(gr.x(cur.x), gr.y(cur.y));
+        (gr.nonzero(Command::Type::lineTo));
+
+    // start point + lineTo points + closing point
+    const std::size_t count(1 + lineTo.count + closed);
+    auto &coords(gr.coords());
+    coords.resize(count);
+
+    coords.x[0] = start.x;
+    coords.y[0] = start.y;
+    if (area) {
+        *area = 0;
+        gr.shift(cur, 1, lineTo.count, *area);
+    } else {
+        gr.shift(cur, 1, lineTo.count);
     }
 
-    if (!closed) { return ls; }
+    if (closed) {
+        // expect closePath{1}
+        auto closePath
+            (gr.nonzero(Command::Type::closePath));
+
+        // last segment
+        coords.x[count - 1] = start.x;
+        coords.y[count - 1] = start.y;
+        if (area) {
+            *area += (std::int64_t(cur.x) * start.y
+                      - std::int64_t(start.x) * cur.y);
+        }
+    }
 
-    // expect closePath{1}
-    auto closePath
-        (checkNonzero(gr.command(Command::Type::closePath)));
+    // convert all points in one pass
+    gr.transform(count);
+    return count;
+}
 
-    // last segment
-    ls->addPoint(gr.x(start.x), gr.y(start.y));
+template <typename Type = ::OGRLineString, typename Reader>
+std::unique_ptr<Type>
+singleLineString(Reader &gr, Cursor &cur, bool closed = false
+                 , std::int64_t *area = nullptr)
+{
+    const auto count(readPath(gr, cur, closed, area));
 
+    // pass all points to OGR at once
+    const auto &coords(gr.coords());
+    std::unique_ptr<Type> ls(new Type());
+    ls->setPoints(count, coords.x.data(), coords.y.data());
     return ls;
 }
 
-std::unique_ptr< ::OGRGeometry> lineStrings(GeometryReader &gr)
+template <typename Reader>
+std::unique_ptr< ::OGRGeometry> lineStrings(Reader &gr)
 {
     Cursor cur;
 
@@ -374,7 +835,8 @@ std::unique_ptr< ::OGRGeometry> lineStrings(GeometryReader &gr)
     return multi;
 }
 
-std::unique_ptr< ::OGRGeometry> polygons(GeometryReader &gr)
+template <typename Reader>
+std::unique_ptr< ::OGRGeometry> polygons(Reader &gr)
 {
     Cursor cur;
 
@@ -382,9 +844,14 @@ std::unique_ptr< ::OGRGeometry> polygons(GeometryReader &gr)
     std::unique_ptr< ::OGRMultiPolygon> multi;
 
     while (gr) {
-        // single linear ring
-        auto ls(singleLineString< ::OGRLinearRing>(gr, cur, true));
-        if (ls->isClockwise()) {
+        // single linear ring, orientation given by its area in tile space
+        std::int64_t area(0);
+        auto ls(singleLineString< ::OGRLinearRing>(gr, cur, true, &area));
+
+        // degenerate ring, skip
+        if (!area) { continue; }
+
+        if (area > 0) {
             // exterior ring
             if (single) {
                 // previous polygon was first
@@ -410,13 +877,18 @@ std::unique_ptr< ::OGRGeometry> polygons(GeometryReader &gr)
 
     // single or multi?
     if (single) { return single; }
-    return multi;
+    if (multi) { return multi; }
+
+    // all rings degenerate
+    return std::unique_ptr< ::OGRGeometry>(new ::OGRPolygon());
 }
 
+template <typename Reader>
 std::unique_ptr< ::OGRGeometry>
-generateGeometry(const vector_tile::Tile_Feature &feature, const Trafo &trafo)
+generateGeometry(const vector_tile::Tile_Feature &feature, const Trafo &trafo
+                 , Coordinates &coords)
 {
-    GeometryReader gr(trafo, feature.geometry());
+    Reader gr(trafo, feature.geometry(), coords);
     switch (feature.type()) {
     case vector_tile::Tile_GeomType::Tile_GeomType_POINT:
         return points(gr);
@@ -434,6 +906,80 @@ generateGeometry(const vector_tile::Tile_Feature &feature, const Trafo &trafo)
     return {};
 }
 
+void appendPart(MvtDataset::Columns &columns, const Coordinates &coords
+                , std::size_t count, bool exterior = false)
+{
+    columns.x.insert(columns.x.end(), coords.x.begin()
+                     , coords.x.begin() + count);
+    columns.y.insert(columns.y.end(), coords.y.begin()
+                     , coords.y.begin() + count);
+    columns.parts.push_back(columns.x.size());
+    columns.exterior.push_back(exterior);
+}
+
+/** Decodes geometry directly into columns, no OGR geometry is built.
+ */
+template <typename Reader>
+::OGRwkbGeometryType
+appendGeometry(const vector_tile::Tile_Feature &feature, const Trafo &trafo
+               , Coordinates &coords, MvtDataset::Columns &columns)
+{
+    Reader gr(trafo, feature.geometry(), coords);
+    Cursor cur;
+
+    switch (feature.type()) {
+    case vector_tile::Tile_GeomType::Tile_GeomType_POINT: {
+        // all points in single part
+        auto moveTo
+            (gr.nonzero(Command::Type::moveTo));
+        coords.resize(moveTo.count);
+        gr.shift(cur, 0, moveTo.count);
+        gr.transform(moveTo.count);
+        appendPart(columns, coords, moveTo.count);
+
+        return ((moveTo.count == 1)
+                ? ::OGRwkbGeometryType::wkbPoint
+                : ::OGRwkbGeometryType::wkbMultiPoint);
+    }
+
+    case vector_tile::Tile_GeomType::Tile_GeomType_LINESTRING: {
+        std::size_t parts(0);
+        for (; gr; ++parts) {
+            appendPart(columns, coords, readPath(gr, cur, false));
+        }
+
+        return ((parts == 1)
+                ? ::OGRwkbGeometryType::wkbLineString
+                : ::OGRwkbGeometryType::wkbMultiLineString);
+    }
+
+    case vector_tile::Tile_GeomType::Tile_GeomType_POLYGON: {
+        std::size_t polygons(0);
+        while (gr) {
+            std::int64_t area(0);
+            const auto count(readPath(gr, cur, true, &area));
+
+            // degenerate ring, skip
+            if (!area) { continue; }
+
+            // leading interior ring starts polygon as well
+            const bool exterior((area > 0) || !polygons);
+            if (exterior) { ++polygons; }
+            appendPart(columns, coords, count, exterior);
+        }
+
+        return ((polygons <= 1)
+                ? ::OGRwkbGeometryType::wkbPolygon
+                : ::OGRwkbGeometryType::wkbMultiPolygon);
+    }
+
+    default: break;
+    }
+
+    // should be never reached
+    return ::OGRwkbGeometryType::wkbUnknown;
+}
+
 struct GetValue {
     GetValue(const vector_tile::Tile_Value &value) : value(value) {}
     const vector_tile::Tile_Value &value;
@@ -470,341 +1016,2968 @@ std::ostream& operator<<(std::ostream &os, const GetValue &gv)
     return ::OGRFieldSubType::OFSTNone;
 }
 
-void setField(::OGRFeature &feature, int i
-              , const vector_tile::Tile_Value &value
-              , bool fid)
+inline bool isNumeric(::OGRFieldType type)
 {
-    if (value.has_string_value()) {
-        feature.SetField(i, value.string_value().c_str());
-        return;
-    }
+    return ((type == ::OGRFieldType::OFTInteger)
+            || (type == ::OGRFieldType::OFTInteger64)
+            || (type == ::OGRFieldType::OFTReal));
+}
 
-    if (value.has_float_value()) {
-        feature.SetField(i, value.float_value());
-        return;
-    }
+/** Field type accumulated over all values of one key.
+ */
+struct FieldType {
+    bool used;
+    ::OGRFieldType type;
+    ::OGRFieldSubType subType;
+
+    FieldType()
+        : used(false), type(::OGRFieldType::OFTString)
+        , subType(::OGRFieldSubType::OFSTNone)
+    {}
 
-    if (value.has_double_value()) {
-        feature.SetField(i, value.double_value());
-        return;
-    }
+    /** Widens type to be able to hold given value.
+     */
+    void update(const vector_tile::Tile_Value &value);
 
-    if (value.has_int_value()) {
-        feature.SetField(i, GIntBig(value.int_value()));
-        if (fid) { feature.SetFID(GIntBig(value.int_value())); }
-        return;
-    }
+    /** Widens type to be able to hold values of other type.
+     */
+    void update(const FieldType &other);
 
-    if (value.has_uint_value()) {
-        feature.SetField(i, GIntBig(value.uint_value()));
-        if (fid) { feature.SetFID(GIntBig(value.int_value())); }
-        return;
-    }
+private:
+    void update(::OGRFieldType vType, ::OGRFieldSubType vSubType);
+};
 
-    if (value.has_sint_value()) {
-        feature.SetField(i, GIntBig(value.sint_value()));
-        if (fid) { feature.SetFID(GIntBig(value.int_value())); }
-        return;
-    }
+void FieldType::update(const vector_tile::Tile_Value &value)
+{
+    update(ogrType(value), ogrSubType(value));
+}
+
+void FieldType::update(const FieldType &other)
+{
+    if (other.used) { update(other.type, other.subType); }
+}
 
-    if (value.has_bool_value()) {
-        feature.SetField(i, int(value.bool_value()));
+void FieldType::update(::OGRFieldType vType, ::OGRFieldSubType vSubType)
+{
+    if (!used) {
+        // first value
+        used = true;
+        type = vType;
+        subType = vSubType;
         return;
     }
 
-    // unknown
-    feature.SetField(i, "");
-}
+    // subtype survives only if shared by all values
+    if (subType != vSubType) { subType = ::OGRFieldSubType::OFSTNone; }
 
-} // namespace
+    if (type == vType) { return; }
 
-::OGRFeature* MvtDataset::Layer::GetNextFeature()
-{
-    // skip unknown feature
-    while ((ifeatures_ != efeatures_)
-           && (ifeatures_->type()
-               == vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN))
-    {
-        ++ifeatures_;
+    if (isNumeric(type) && isNumeric(vType)) {
+        // mixed numbers: real wins, otherwise widen to 64 bit integer
+        if ((type == ::OGRFieldType::OFTReal)
+            || (vType == ::OGRFieldType::OFTReal))
+        {
+            type = ::OGRFieldType::OFTReal;
+        } else {
+            type = ::OGRFieldType::OFTInteger64;
+        }
+        return;
     }
-    if (ifeatures_ == efeatures_) { return nullptr; }
 
-    // valid feature
-    const auto &feature(*ifeatures_);
-
-    auto *defn(new ::OGRFeatureDefn());
-    defn->SetGeomType(type(feature.type()));
+    // incompatible types, fall back to string
+    type = ::OGRFieldType::OFTString;
+    subType = ::OGRFieldSubType::OFSTNone;
+}
 
-    std::unique_ptr< ::OGRFeature> of;
+/** Accumulates value types of all keys over all features of given layer.
+ */
+std::vector<FieldType> fieldTypes(const vector_tile::Tile_Layer &layer)
+{
+    const auto keyCount(layer.keys_size());
+    const auto valueCount(layer.values_size());
+
+    std::vector<FieldType> types(keyCount);
+    for (const auto &feature : layer.features()) {
+        if (feature.type()
+            == vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN)
+        {
+            continue;
+        }
 
-    if (!ds_.noFields_) {
         // get tag count and make even if odd
         auto tagCount(feature.tags_size());
         if (tagCount & 0x1) { --tagCount; }
 
-        int idField(-1);
-
-        // prepare field definitions
         for (decltype(tagCount) i(0); i < tagCount; i += 2) {
-            // get and validate key and value endices
             const auto keyIndex(feature.tags(i));
             const auto valueIndex(feature.tags(i + 1));
 
-            if ((keyIndex >= std::size_t(layer_.keys_size()))
-                || (valueIndex >= std::size_t(layer_.values_size()))) {
+            if ((keyIndex >= std::size_t(keyCount))
+                || (valueIndex >= std::size_t(valueCount))) {
                 // key or value index out of bounds, ignore this attribute
                 continue;
             }
 
-            const auto &value(layer_.values(valueIndex));
-            // build field definition
-            auto name(layer_.keys(keyIndex));
-            ::OGRFieldDefn def(name.c_str(), ogrType(value));
-            def.SetSubType(ogrSubType(value));
-            defn->AddFieldDefn(&def);
-
-            // "id" -> remember field id
-            if (name == "id") { idField = i / 2; }
+            types[keyIndex].update(layer.values(valueIndex));
         }
+    }
 
-        // create feature
-        of = std::unique_ptr< ::OGRFeature>(new ::OGRFeature(defn));
+    return types;
+}
 
-        // feature has id -> use it as id
-        if (feature.has_id()) {
-            // we have feature id, use it and unsed "id" field index
-            of->SetFID(feature.id());
-            idField = -1;
+TagValue::list tagValues(const vector_tile::Tile_Layer &layer)
+{
+    TagValue::list values(layer.values_size());
+    auto ivalues(values.begin());
+    for (const auto &value : layer.values()) {
+        auto &tv(*ivalues++);
+        if (value.has_string_value()) {
+            tv.kind = TagValue::Kind::string;
+            tv.string = &value.string_value();
+        } else if (value.has_float_value()) {
+            tv.kind = TagValue::Kind::real;
+            tv.real = value.float_value();
+        } else if (value.has_double_value()) {
+            tv.kind = TagValue::Kind::real;
+            tv.real = value.double_value();
+        } else if (value.has_int_value()) {
+            tv.kind = TagValue::Kind::integer;
+            tv.integer = value.int_value();
+            tv.real = value.int_value();
+        } else if (value.has_uint_value()) {
+            tv.kind = TagValue::Kind::integer;
+            tv.integer = value.uint_value();
+            tv.real = value.uint_value();
+        } else if (value.has_sint_value()) {
+            tv.kind = TagValue::Kind::integer;
+            tv.integer = value.sint_value();
+            tv.real = value.sint_value();
+        } else if (value.has_bool_value()) {
+            tv.kind = TagValue::Kind::boolean;
+            tv.integer = tv.real = value.bool_value();
         }
+    }
 
-        // fill in fields
-        int fid(0);
-        for (decltype(tagCount) i(0); i < tagCount; i += 2, ++fid) {
-            // get and validate key and value endices
-            const auto keyIndex(feature.tags(i));
-            const auto valueIndex(feature.tags(i + 1));
-
-            if ((keyIndex >= std::size_t(layer_.keys_size()))
-                || (valueIndex >= std::size_t(layer_.values_size()))) {
-                // key or value index out of bounds, ignore this attribute
-                continue;
-            }
+    return values;
+}
 
-            const auto &value(layer_.values(valueIndex));
-            setField(*of, fid, value, (fid == idField));
-        }
-    } else {
-        of = std::unique_ptr< ::OGRFeature>(new ::OGRFeature(defn));
+/** Returns index of "id" key or -1 if there is no such key.
+ */
+int idKey(const vector_tile::Tile_Layer &layer)
+{
+    const auto keyCount(layer.keys_size());
+    for (int k(0); k < keyCount; ++k) {
+        if (layer.keys(k) == "id") { return k; }
+    }
+    return -1;
+}
+
+void setField(::OGRFeature &feature, int i, const TagValue &value
+              , bool fid)
+{
+    switch (value.kind) {
+    case TagValue::Kind::string:
+        feature.SetField(i, value.string->c_str());
+        return;
+
+    case TagValue::Kind::real:
+        feature.SetField(i, value.real);
+        return;
+
+    case TagValue::Kind::integer:
+        feature.SetField(i, value.integer);
+        if (fid) { feature.SetFID(value.integer); }
+        return;
+
+    case TagValue::Kind::boolean:
+        feature.SetField(i, int(value.integer));
+        return;
+
+    default:
+        // unknown
+        feature.SetField(i, "");
+        return;
+    }
+}
+
+void appendValue(MvtDataset::Columns::Column &column, const TagValue &value)
+{
+    if (value.kind == TagValue::Kind::unknown) {
+        // unknown values are stored only to string columns
+        if (column.type != ::OGRFieldType::OFTString) { return; }
+    }
+
+    switch (column.type) {
+    case ::OGRFieldType::OFTInteger:
+    case ::OGRFieldType::OFTInteger64:
+        if ((value.kind != TagValue::Kind::integer)
+            && (value.kind != TagValue::Kind::boolean))
+        {
+            return;
+        }
+        column.integers.back() = value.integer;
+        break;
+
+    case ::OGRFieldType::OFTReal:
+        if (value.kind == TagValue::Kind::string) { return; }
+        column.reals.back() = value.real;
+        break;
+
+    default: {
+        // string, format numbers the same way as OGR does
+        auto &s(column.strings);
+        switch (value.kind) {
+        case TagValue::Kind::string: s += *value.string; break;
+        case TagValue::Kind::real:
+            s += ::CPLSPrintf("%.15g", value.real);
+            break;
+        case TagValue::Kind::integer:
+        case TagValue::Kind::boolean:
+            s += std::to_string(value.integer);
+            break;
+        default: break;
+        }
+        column.offsets.back() = s.size();
+        break;
+    } }
+
+    column.valid.back() = 1;
+}
+
+/** Checks whether value can match constant from attribute filter. Errs on the
+ *  safe side: returns true whenever the full evaluation could succeed.
+ */
+bool mayMatch(const vector_tile::Tile_Value &value, ::OGRFieldType type
+              , const swq_expr_node &constant)
+{
+    switch (constant.field_type) {
+    case SWQ_STRING:
+        if (type != ::OGRFieldType::OFTString) { return true; }
+        if (!value.has_string_value()) { return true; }
+        // case insensitive to be safe
+        return ba::iequals(value.string_value(), constant.string_value);
+
+    case SWQ_INTEGER:
+    case SWQ_INTEGER64:
+    case SWQ_FLOAT:
+    case SWQ_BOOLEAN:
+        break;
+
+    default:
+        return true;
+    }
+
+    if (!isNumeric(type)) { return true; }
+
+    const double number((constant.field_type == SWQ_FLOAT)
+                        ? constant.float_value
+                        : double(constant.int_value));
+
+    if (value.has_float_value()) { return value.float_value() == number; }
+    if (value.has_double_value()) { return value.double_value() == number; }
+    if (value.has_int_value()) { return double(value.int_value()) == number; }
+    if (value.has_uint_value()) { return double(value.uint_value()) == number; }
+    if (value.has_sint_value()) { return double(value.sint_value()) == number; }
+    if (value.has_bool_value()) { return double(value.bool_value()) == number; }
+    return true;
+}
+
+/** Collects "column = constant" terms from top-level AND chain.
+ */
+void equalityTerms(const swq_expr_node *node
+                   , std::vector<const swq_expr_node*> &terms)
+{
+    if (!node || (node->eNodeType != SNT_OPERATION)) { return; }
+
+    switch (node->nOperation) {
+    case SWQ_AND:
+        for (int i(0); i < node->nSubExprCount; ++i) {
+            equalityTerms(node->papoSubExpr[i], terms);
+        }
+        break;
+
+    case SWQ_EQ:
+        if (node->nSubExprCount == 2) { terms.push_back(node); }
+        break;
+
+    default: break;
+    }
+}
+
+} // namespace
+
+MvtDataset::Layer::Layer(MvtDataset &ds, const vector_tile::Tile_Layer &layer)
+    : noFields_(ds.noFields_), trusted_(ds.trusted_), layer_(layer)
+    , featureDefn_
+      (::OGRFeatureDefn::CreateFeatureDefn(layer_.name().c_str()))
+    , ifeatures_(layer_.features().begin())
+    , efeatures_(layer_.features().end())
+    , trafo_(ds.raw_
+             ? Trafo(math::Point2d(0.0, 0.0), math::Size2f(1.0, 1.0))
+             : Trafo(layer_.extent(), ds.extents_, ds.ct_))
+    , idKey_(-1)
+    , featureCount_(-1)
+{
+    featureDefn_->Reference();
+
+    if (ds.raw_) {
+        // publish transformation from tile space to world, GDAL style
+        const Trafo world(layer_.extent(), ds.extents_);
+        const auto &shift(world.shift());
+        const auto &scale(world.scale());
+        SetMetadataItem("MVT_EXTENT"
+                        , std::to_string(layer_.extent()).c_str());
+        SetMetadataItem("MVT_GEOTRANSFORM"
+                        , ::CPLSPrintf("%.17g,%.17g,0,%.17g,0,%.17g"
+                                       , shift(0), scale.width
+                                       , shift(1), scale.height));
+
+        if (ds.srs_) {
+            char *wkt(nullptr);
+            if (ds.srs_->reference().exportToWkt(&wkt) == OGRERR_NONE) {
+                SetMetadataItem("MVT_SRS", wkt);
+            }
+            ::CPLFree(wkt);
+        }
+    } else if (ds.targetSrs_) {
+        srs_ = std::make_shared< ::OGRSpatialReference>
+            (ds.targetSrs_->reference());
+    } else if (ds.srs_) {
+        srs_ = std::make_shared< ::OGRSpatialReference>
+            (ds.srs_->reference());
+    }
+
+    if (!noFields_) { buildSchema(); }
+}
+
+MvtDataset::Layer::Layer(const vector_tile::Tile_Layer &layer
+                         , ::OGRFeatureDefn *featureDefn
+                         , const Trafo &trafo
+                         , const std::shared_ptr< ::OGRSpatialReference> &srs
+                         , bool noFields, bool trusted)
+    : srs_(srs), noFields_(noFields), trusted_(trusted), layer_(layer)
+    , featureDefn_(featureDefn)
+    , ifeatures_(layer_.features().begin())
+    , efeatures_(layer_.features().end())
+    , trafo_(trafo)
+    , idKey_(-1)
+    , featureCount_(-1)
+{
+    featureDefn_->Reference();
+
+    if (noFields_) { return; }
+
+    idKey_ = idKey(layer_);
+    values_ = tagValues(layer_);
+
+    // map keys to fields by name
+    const auto keyCount(layer_.keys_size());
+    keyToField_.assign(keyCount, -1);
+    for (int k(0); k < keyCount; ++k) {
+        keyToField_[k] = featureDefn_->GetFieldIndex(layer_.keys(k).c_str());
+    }
+}
+
+void MvtDataset::Layer::buildSchema()
+{
+    const auto keyCount(layer_.keys_size());
+    const auto types(fieldTypes(layer_));
+    idKey_ = idKey(layer_);
+    values_ = tagValues(layer_);
+
+    // build field definitions in key order
+    keyToField_.assign(keyCount, -1);
+    for (int k(0); k < keyCount; ++k) {
+        const auto &type(types[k]);
+        if (!type.used) { continue; }
+
+        ::OGRFieldDefn def(layer_.keys(k).c_str(), type.type);
+        def.SetSubType(type.subType);
+        featureDefn_->AddFieldDefn(&def);
+        keyToField_[k] = featureDefn_->GetFieldCount() - 1;
+    }
+}
+
+::OGRErr MvtDataset::Layer::GetExtent(::OGREnvelope *extent, int force)
+{
+    // reprojected bounding box must be computed from geometries
+    if (trafo_.projected()) { return ::OGRLayer::GetExtent(extent, force); }
+
+    if (!extent_) {
+        // bounding box in tile space, only command streams are walked
+        TileBounds bounds;
+        for (const auto &feature : layer_.features()) {
+            if (feature.type()
+                == vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN)
+            {
+                continue;
+            }
+
+            TileBounds fb;
+            if (tileBounds(feature.geometry(), fb)) { bounds.update(fb); }
+        }
+
+        if (!bounds.valid()) { return OGRERR_FAILURE; }
+
+        // convert to world, Y axis is flipped
+        const auto y1(trafo_.y(bounds.ymin)), y2(trafo_.y(bounds.ymax));
+
+        ::OGREnvelope e;
+        e.MinX = trafo_.x(bounds.xmin);
+        e.MaxX = trafo_.x(bounds.xmax);
+        e.MinY = std::min(y1, y2);
+        e.MaxY = std::max(y1, y2);
+        extent_ = e;
+    }
+
+    *extent = *extent_;
+    return OGRERR_NONE;
+}
+
+void MvtDataset::Layer::SetSpatialFilter(::OGRGeometry *geometry)
+{
+    if (!InstallFilter(geometry)) { return; }
+    ResetReading();
+
+    tileFilter_ = boost::none;
+    if (!m_poFilterGeom || trafo_.projected()) { return; }
+
+    // convert filter envelope to tile space, Y axis is flipped
+    const auto &e(m_sFilterEnvelope);
+    const auto x1(trafo_.ix(e.MinX)), x2(trafo_.ix(e.MaxX));
+    const auto y1(trafo_.iy(e.MinY)), y2(trafo_.iy(e.MaxY));
+
+    // add one tile unit to be immune to rounding errors
+    tileFilter_ = math::Extents2(std::min(x1, x2) - 1.0
+                                 , std::min(y1, y2) - 1.0
+                                 , std::max(x1, x2) + 1.0
+                                 , std::max(y1, y2) + 1.0);
+}
+
+::OGRErr MvtDataset::Layer::SetAttributeFilter(const char *query)
+{
+    valueFilters_.clear();
+
+    const auto err(::OGRLayer::SetAttributeFilter(query));
+    if ((err != OGRERR_NONE) || !m_poAttrQuery) { return err; }
+
+    // map fields back to keys
+    std::vector<int> fieldToKey(featureDefn_->GetFieldCount(), -1);
+    for (std::size_t k(0); k < keyToField_.size(); ++k) {
+        if (keyToField_[k] >= 0) { fieldToKey[keyToField_[k]] = k; }
+    }
+
+    std::vector<const swq_expr_node*> terms;
+    equalityTerms(static_cast<const swq_expr_node*>
+                  (m_poAttrQuery->GetSWQExpr()), terms);
+
+    for (const auto *term : terms) {
+        const auto *column(term->papoSubExpr[0]);
+        const auto *constant(term->papoSubExpr[1]);
+        if (column->eNodeType != SNT_COLUMN) { std::swap(column, constant); }
+
+        if ((column->eNodeType != SNT_COLUMN)
+            || (constant->eNodeType != SNT_CONSTANT)
+            || constant->is_null
+            || (column->field_index < 0)
+            || (column->field_index >= int(fieldToKey.size())))
+        {
+            // not a simple term or a special field (FID etc.)
+            continue;
+        }
+
+        const auto key(fieldToKey[column->field_index]);
+        if (key < 0) { continue; }
+        const auto type(featureDefn_->GetFieldDefn(column->field_index)
+                        ->GetType());
+
+        // evaluate term against every value in the values table once
+        valueFilters_.emplace_back();
+        auto &vf(valueFilters_.back());
+        vf.key = key;
+        vf.values.reserve(layer_.values_size());
+        for (const auto &value : layer_.values()) {
+            vf.values.push_back(mayMatch(value, type, *constant));
+        }
+    }
+
+    return err;
+}
+
+bool MvtDataset::Layer::prefilter(const vector_tile::Tile_Feature &feature)
+    const
+{
+    // attribute prefilter: every term must be satisfied by some tag
+    if (!valueFilters_.empty()) {
+        auto tagCount(feature.tags_size());
+        if (tagCount & 0x1) { --tagCount; }
+
+        for (const auto &vf : valueFilters_) {
+            bool found(false);
+            for (decltype(tagCount) i(0); i < tagCount; i += 2) {
+                if (feature.tags(i) != vf.key) { continue; }
+                const auto valueIndex(feature.tags(i + 1));
+                if ((valueIndex < vf.values.size())
+                    && vf.values[valueIndex])
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) { return false; }
+        }
+    }
+
+    // spatial prefilter, malformed geometry is left for full decoding
+    if (tileFilter_) {
+        TileBounds b;
+        if (tileBounds(feature.geometry(), b)) {
+            const auto &f(*tileFilter_);
+            if ((b.xmax < f.ll(0)) || (b.xmin > f.ur(0))
+                || (b.ymax < f.ll(1)) || (b.ymin > f.ur(1)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr< ::OGRFeature>
+MvtDataset::Layer::createFeature(const vector_tile::Tile_Feature &feature)
+{
+    std::unique_ptr< ::OGRFeature> of(new ::OGRFeature(featureDefn_));
+
+    if (!noFields_) {
+        // get tag count and make even if odd
+        auto tagCount(feature.tags_size());
+        if (tagCount & 0x1) { --tagCount; }
+
+        // feature has id -> use it as id and ignore "id" field
+        const bool hasId(feature.has_id());
+        if (hasId) { of->SetFID(feature.id()); }
+
+        // fill in fields
+        for (decltype(tagCount) i(0); i < tagCount; i += 2) {
+            // get and validate key and value endices
+            const auto keyIndex(feature.tags(i));
+            const auto valueIndex(feature.tags(i + 1));
+
+            if ((keyIndex >= std::size_t(layer_.keys_size()))
+                || (valueIndex >= std::size_t(layer_.values_size()))) {
+                // key or value index out of bounds, ignore this attribute
+                continue;
+            }
+
+            const auto field(keyToField_[keyIndex]);
+            if (field < 0) { continue; }
+
+            setField(*of, field, values_[valueIndex]
+                     , (!hasId && (int(keyIndex) == idKey_)));
+        }
+    }
+
+    // set geometry
+    auto geometry(trusted_
+                  ? generateGeometry<TrustedGeometryReader>
+                  (feature, trafo_, coords_)
+                  : generateGeometry<GeometryReader>
+                  (feature, trafo_, coords_));
+    if (srs_) { geometry->assignSpatialReference(srs_.get()); }
+    of->SetGeometryDirectly(geometry.release());
+
+    return of;
+}
+
+::OGRFeature* MvtDataset::Layer::GetNextFeature()
+{
+    for (; ifeatures_ != efeatures_; ++ifeatures_) {
+        const auto &feature(*ifeatures_);
+
+        // skip unknown feature
+        if (feature.type()
+            == vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN)
+        {
+            continue;
+        }
+
+        // reject without decoding if possible
+        if (!prefilter(feature)) { continue; }
+
+        std::unique_ptr< ::OGRFeature> of;
+        try {
+            of = createFeature(feature);
+        } catch (const std::exception &e) {
+            CPLError(CE_Failure, CPLE_AssertionFailed
+                     , "Error processing feature's geometry: <%s>."
+                     , e.what());
+            return nullptr;
+        }
+
+        // exact filtering
+        if (m_poFilterGeom && !FilterGeometry(of->GetGeometryRef())) {
+            continue;
+        }
+        if (m_poAttrQuery && !m_poAttrQuery->Evaluate(of.get())) {
+            continue;
+        }
+
+        // next
+        ++ifeatures_;
+        return of.release();
+    }
+
+    return nullptr;
+}
+
+void MvtDataset::Layer::read(Columns &columns)
+{
+    columns = {};
+    columns.featureParts.push_back(0);
+    columns.parts.push_back(0);
+
+    // prepare columns from layer schema
+    const auto fieldCount(featureDefn_->GetFieldCount());
+    auto &cols(columns.columns);
+    cols.resize(fieldCount);
+    for (int i(0); i < fieldCount; ++i) {
+        const auto *def(featureDefn_->GetFieldDefn(i));
+        cols[i].name = def->GetNameRef();
+        cols[i].type = def->GetType();
+        if (cols[i].type == ::OGRFieldType::OFTString) {
+            cols[i].offsets.push_back(0);
+        }
+    }
+
+    const auto keyCount(layer_.keys_size());
+    const auto valueCount(layer_.values_size());
+
+    for (const auto &feature : layer_.features()) {
+        // skip unknown feature
+        if (feature.type()
+            == vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN)
+        {
+            continue;
+        }
+
+        columns.type.push_back
+            (trusted_
+             ? appendGeometry<TrustedGeometryReader>
+             (feature, trafo_, coords_, columns)
+             : appendGeometry<GeometryReader>
+             (feature, trafo_, coords_, columns));
+        columns.featureParts.push_back(columns.parts.size() - 1);
+
+        const bool hasId(feature.has_id());
+        columns.fid.push_back(hasId ? ::GIntBig(feature.id()) : OGRNullFID);
+
+        // add empty value to every column
+        for (auto &column : cols) {
+            column.valid.push_back(0);
+            switch (column.type) {
+            case ::OGRFieldType::OFTInteger:
+            case ::OGRFieldType::OFTInteger64:
+                column.integers.push_back(0);
+                break;
+
+            case ::OGRFieldType::OFTReal:
+                column.reals.push_back(0.0);
+                break;
+
+            default:
+                column.offsets.push_back(column.strings.size());
+                break;
+            }
+        }
+
+        if (noFields_) { continue; }
+
+        // get tag count and make even if odd
+        auto tagCount(feature.tags_size());
+        if (tagCount & 0x1) { --tagCount; }
+
+        for (decltype(tagCount) i(0); i < tagCount; i += 2) {
+            // get and validate key and value endices
+            const auto keyIndex(feature.tags(i));
+            const auto valueIndex(feature.tags(i + 1));
+
+            if ((keyIndex >= std::size_t(keyCount))
+                || (valueIndex >= std::size_t(valueCount))) {
+                // key or value index out of bounds, ignore this attribute
+                continue;
+            }
+
+            const auto field(keyToField_[keyIndex]);
+            if (field < 0) { continue; }
+
+            auto &column(cols[field]);
+            if (column.valid.back()) {
+                // duplicate tag, first one wins
+                continue;
+            }
+
+            appendValue(column, values_[valueIndex]);
+
+            if (!hasId && (int(keyIndex) == idKey_)
+                && (column.type != ::OGRFieldType::OFTString)
+                && (column.type != ::OGRFieldType::OFTReal))
+            {
+                columns.fid.back() = column.integers.back();
+            }
+        }
+    }
+}
+
+namespace {
+
+typedef std::remove_pointer
+<decltype(vector_tile::Tile_Feature().mutable_geometry())>::type
+MvtGeometryOutput;
+
+inline std::uint32_t zigzag(std::int32_t value)
+{
+    return ((std::uint32_t(value) << 1) ^ std::uint32_t(value >> 31));
+}
+
+/** Encodes OGR geometry into MVT command stream. Coordinates are quantized
+ *  to tile integer space in bulk, no WKB is involved.
+ */
+class GeometryWriter {
+public:
+    GeometryWriter(const Trafo &trafo, Coordinates &coords
+                   , MvtGeometryOutput &output)
+        : trafo_(trafo), coords_(coords), output_(output)
+    {}
+
+    /** Writes geometry, returns its MVT type. Returns UNKNOWN if geometry
+     *  type is not supported or nothing was left after quantization.
+     */
+    vector_tile::Tile_GeomType write(::OGRGeometry &geometry);
+
+private:
+    void command(Command::Type type, std::uint32_t count) {
+        output_.Add((std::uint32_t(type) & 0x7) | (count << 3));
+    }
+
+    void point(std::size_t i) {
+        const auto x(std::int32_t(coords_.x[i]));
+        const auto y(std::int32_t(coords_.y[i]));
+        output_.Add(zigzag(x - cursor_.x));
+        output_.Add(zigzag(y - cursor_.y));
+        cursor_.x = x;
+        cursor_.y = y;
+    }
+
+    /** Quantizes count coordinates stored at given index in the buffer.
+     */
+    void quantize(std::size_t index, std::size_t count);
+
+    /** Loads curve into buffer, quantizes it and removes repeated points.
+     *  Returns number of points left.
+     */
+    std::size_t load(::OGRSimpleCurve &curve);
+
+    bool lineString(::OGRLineString &ls);
+    bool ring(::OGRLinearRing &ring, bool exterior);
+    bool polygon(::OGRPolygon &polygon);
+
+    /** Writes count points from buffer as moveTo{1} lineTo{count - 1}.
+     */
+    void path(std::size_t count);
+
+    const Trafo &trafo_;
+    Coordinates &coords_;
+    MvtGeometryOutput &output_;
+    Cursor cursor_;
+};
+
+void GeometryWriter::quantize(std::size_t index, std::size_t count)
+{
+    auto *x(coords_.x.data() + index);
+    auto *y(coords_.y.data() + index);
+    trafo_.inverse(count, x, y);
+
+    // far away points are clamped to keep integer arithmetic safe
+    const double limit(1 << 28);
+    for (std::size_t i(0); i < count; ++i) {
+        x[i] = std::max(-limit, std::min(limit, std::round(x[i])));
+        y[i] = std::max(-limit, std::min(limit, std::round(y[i])));
+    }
+}
+
+std::size_t GeometryWriter::load(::OGRSimpleCurve &curve)
+{
+    const std::size_t count(curve.getNumPoints());
+    coords_.resize(count);
+    if (!count) { return 0; }
+
+    curve.getPoints(coords_.x.data(), sizeof(double)
+                    , coords_.y.data(), sizeof(double));
+    quantize(0, count);
+
+    // drop repeated points
+    auto &x(coords_.x);
+    auto &y(coords_.y);
+    std::size_t size(1);
+    for (std::size_t i(1); i < count; ++i) {
+        if ((x[i] == x[size - 1]) && (y[i] == y[size - 1])) { continue; }
+        x[size] = x[i];
+        y[size] = y[i];
+        ++size;
+    }
+    return size;
+}
+
+void GeometryWriter::path(std::size_t count)
+{
+    command(Command::Type::moveTo, 1);
+    point(0);
+    command(Command::Type::lineTo, count - 1);
+    for (std::size_t i(1); i < count; ++i) { point(i); }
+}
+
+bool GeometryWriter::lineString(::OGRLineString &ls)
+{
+    const auto count(load(ls));
+    if (count < 2) { return false; }
+    path(count);
+    return true;
+}
+
+bool GeometryWriter::ring(::OGRLinearRing &ring, bool exterior)
+{
+    auto count(load(ring));
+
+    // drop closing point
+    auto &x(coords_.x);
+    auto &y(coords_.y);
+    if ((count > 1) && (x[0] == x[count - 1]) && (y[0] == y[count - 1])) {
+        --count;
+    }
+    if (count < 3) { return false; }
+
+    // surveyor's formula in tile space (Y axis down)
+    std::int64_t area(0);
+    for (std::size_t i(0); i < count; ++i) {
+        const auto j((i + 1) % count);
+        area += (std::int64_t(x[i]) * std::int64_t(y[j])
+                 - std::int64_t(x[j]) * std::int64_t(y[i]));
+    }
+    if (!area) { return false; }
+
+    // exterior ring must have positive area, interior negative
+    if ((area > 0) != exterior) {
+        std::reverse(x.begin() + 1, x.begin() + count);
+        std::reverse(y.begin() + 1, y.begin() + count);
+    }
+
+    path(count);
+    command(Command::Type::closePath, 1);
+    return true;
+}
+
+bool GeometryWriter::polygon(::OGRPolygon &polygon)
+{
+    auto *exterior(polygon.getExteriorRing());
+    if (!exterior || !ring(*exterior, true)) { return false; }
+
+    for (int i(0), e(polygon.getNumInteriorRings()); i < e; ++i) {
+        ring(*polygon.getInteriorRing(i), false);
+    }
+    return true;
+}
+
+vector_tile::Tile_GeomType GeometryWriter::write(::OGRGeometry &geometry)
+{
+    const auto unknown(vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN);
+
+    switch (::wkbFlatten(geometry.getGeometryType())) {
+    case ::wkbPoint: {
+        auto &p(static_cast< ::OGRPoint&>(geometry));
+        if (p.IsEmpty()) { return unknown; }
+        coords_.resize(1);
+        coords_.x[0] = p.getX();
+        coords_.y[0] = p.getY();
+        quantize(0, 1);
+        command(Command::Type::moveTo, 1);
+        point(0);
+        return vector_tile::Tile_GeomType::Tile_GeomType_POINT;
+    }
+
+    case ::wkbMultiPoint: {
+        auto &mp(static_cast< ::OGRGeometryCollection&>(geometry));
+        coords_.resize(mp.getNumGeometries());
+        std::size_t count(0);
+        for (int i(0), e(mp.getNumGeometries()); i < e; ++i) {
+            auto &p(static_cast< ::OGRPoint&>(*mp.getGeometryRef(i)));
+            if (p.IsEmpty()) { continue; }
+            coords_.x[count] = p.getX();
+            coords_.y[count] = p.getY();
+            ++count;
+        }
+        if (!count) { return unknown; }
+
+        quantize(0, count);
+        command(Command::Type::moveTo, count);
+        for (std::size_t i(0); i < count; ++i) { point(i); }
+        return vector_tile::Tile_GeomType::Tile_GeomType_POINT;
+    }
+
+    case ::wkbLineString:
+        if (!lineString(static_cast< ::OGRLineString&>(geometry))) {
+            return unknown;
+        }
+        return vector_tile::Tile_GeomType::Tile_GeomType_LINESTRING;
+
+    case ::wkbMultiLineString: {
+        auto &mls(static_cast< ::OGRGeometryCollection&>(geometry));
+        bool written(false);
+        for (int i(0), e(mls.getNumGeometries()); i < e; ++i) {
+            written |= lineString
+                (static_cast< ::OGRLineString&>(*mls.getGeometryRef(i)));
+        }
+        if (!written) { return unknown; }
+        return vector_tile::Tile_GeomType::Tile_GeomType_LINESTRING;
+    }
+
+    case ::wkbPolygon:
+        if (!polygon(static_cast< ::OGRPolygon&>(geometry))) {
+            return unknown;
+        }
+        return vector_tile::Tile_GeomType::Tile_GeomType_POLYGON;
+
+    case ::wkbMultiPolygon: {
+        auto &mp(static_cast< ::OGRGeometryCollection&>(geometry));
+        bool written(false);
+        for (int i(0), e(mp.getNumGeometries()); i < e; ++i) {
+            written |= polygon
+                (static_cast< ::OGRPolygon&>(*mp.getGeometryRef(i)));
+        }
+        if (!written) { return unknown; }
+        return vector_tile::Tile_GeomType::Tile_GeomType_POLYGON;
+    }
+
+    default: break;
+    }
+
+    return unknown;
+}
+
+/** Converts OGR field to MVT value. Returns false if field is not set.
+ */
+bool fieldValue(::OGRFeature &feature, int i, vector_tile::Tile_Value &value)
+{
+    if (!feature.IsFieldSetAndNotNull(i)) { return false; }
+
+    const auto *def(feature.GetFieldDefnRef(i));
+    switch (def->GetType()) {
+    case ::OGRFieldType::OFTInteger:
+    case ::OGRFieldType::OFTInteger64: {
+        const auto v(feature.GetFieldAsInteger64(i));
+        if (def->GetSubType() == ::OGRFieldSubType::OFSTBoolean) {
+            value.set_bool_value(v);
+        } else if (v < 0) {
+            value.set_sint_value(v);
+        } else {
+            value.set_uint_value(v);
+        }
+        break;
+    }
+
+    case ::OGRFieldType::OFTReal:
+        if (def->GetSubType() == ::OGRFieldSubType::OFSTFloat32) {
+            value.set_float_value(feature.GetFieldAsDouble(i));
+        } else {
+            value.set_double_value(feature.GetFieldAsDouble(i));
+        }
+        break;
+
+    default:
+        value.set_string_value(feature.GetFieldAsString(i));
+        break;
+    }
+
+    return true;
+}
+
+} // namespace
+
+class MvtDataset::Writer : public ::OGRLayer
+{
+public:
+    Writer(MvtDataset &ds, vector_tile::Tile_Layer &layer
+           , const std::shared_ptr< ::OGRSpatialReference> &srs);
+
+    virtual ~Writer() {
+        featureDefn_->Release();
+    }
+
+    virtual ::OGRSpatialReference* GetSpatialRef() { return srs_.get(); }
+    virtual void ResetReading() {}
+    virtual ::OGRFeature* GetNextFeature() { return nullptr; }
+    virtual ::OGRFeatureDefn* GetLayerDefn() { return featureDefn_; }
+    virtual int TestCapability(const char *cap);
+    virtual const char* GetName() { return layer_.name().c_str(); }
+
+    virtual ::OGRErr CreateField(::OGRFieldDefn *field, int approxOk);
+    virtual ::OGRErr ICreateFeature(::OGRFeature *feature);
+
+private:
+    /** Returns index of key in layer's keys table, adds new key if needed.
+     */
+    std::uint32_t key(int field);
+
+    /** Returns index of value in layer's values table, adds new value if
+     *  needed.
+     */
+    std::uint32_t value(const vector_tile::Tile_Value &value);
+
+    vector_tile::Tile_Layer &layer_;
+    ::OGRFeatureDefn *featureDefn_;
+    std::shared_ptr< ::OGRSpatialReference> srs_;
+    Trafo trafo_;
+
+    /** Field index to key index, -1 if not used yet.
+     */
+    std::vector<std::int64_t> fieldToKey_;
+
+    /** Serialized value to value index.
+     */
+    std::unordered_map<std::string, std::uint32_t> values_;
+
+    /** Coordinate buffer shared by all encoded geometries.
+     */
+    Coordinates coords_;
+};
+
+MvtDataset::Writer::Writer(MvtDataset &ds, vector_tile::Tile_Layer &layer
+                           , const std::shared_ptr< ::OGRSpatialReference>
+                           &srs)
+    : layer_(layer)
+    , featureDefn_
+      (::OGRFeatureDefn::CreateFeatureDefn(layer_.name().c_str()))
+    , srs_(srs)
+    , trafo_(layer_.extent(), ds.extents_)
+{
+    featureDefn_->Reference();
+}
+
+int MvtDataset::Writer::TestCapability(const char *cap)
+{
+    if (EQUAL(cap, OLCSequentialWrite)) { return TRUE; }
+    if (EQUAL(cap, OLCCreateField)) { return TRUE; }
+    if (EQUAL(cap, OLCStringsAsUTF8)) { return TRUE; }
+    return FALSE;
+}
+
+::OGRErr MvtDataset::Writer::CreateField(::OGRFieldDefn *field, int)
+{
+    if (featureDefn_->GetFieldIndex(field->GetNameRef()) >= 0) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "Field <%s> already exists in layer <%s>."
+                 , field->GetNameRef(), GetName());
+        return OGRERR_FAILURE;
+    }
+
+    featureDefn_->AddFieldDefn(field);
+    fieldToKey_.push_back(-1);
+    return OGRERR_NONE;
+}
+
+std::uint32_t MvtDataset::Writer::key(int field)
+{
+    auto &k(fieldToKey_[field]);
+    if (k < 0) {
+        k = layer_.keys_size();
+        layer_.add_keys(featureDefn_->GetFieldDefn(field)->GetNameRef());
+    }
+    return k;
+}
+
+std::uint32_t MvtDataset::Writer::value(const vector_tile::Tile_Value &value)
+{
+    const auto res(values_.emplace(value.SerializeAsString()
+                                   , layer_.values_size()));
+    if (res.second) { *layer_.add_values() = value; }
+    return res.first->second;
+}
+
+::OGRErr MvtDataset::Writer::ICreateFeature(::OGRFeature *feature)
+{
+    auto *geometry(feature->GetGeometryRef());
+    if (!geometry) {
+        CPLError(CE_Failure, CPLE_NotSupported
+                 , "MVT feature must have a geometry.");
+        return OGRERR_FAILURE;
+    }
+
+    auto &f(*layer_.add_features());
+
+    GeometryWriter gw(trafo_, coords_, *f.mutable_geometry());
+    const auto type(gw.write(*geometry));
+    if (type == vector_tile::Tile_GeomType::Tile_GeomType_UNKNOWN) {
+        layer_.mutable_features()->RemoveLast();
+
+        const auto flat(::wkbFlatten(geometry->getGeometryType()));
+        if ((flat == ::wkbUnknown) || (flat > ::wkbMultiPolygon)) {
+            CPLError(CE_Failure, CPLE_NotSupported
+                     , "Geometry type not supported by MVT.");
+            return OGRERR_FAILURE;
+        }
+
+        // geometry vanished during quantization, nothing to write
+        return OGRERR_NONE;
+    }
+    f.set_type(type);
+
+    if (feature->GetFID() >= 0) { f.set_id(feature->GetFID()); }
+
+    // tags
+    vector_tile::Tile_Value v;
+    for (int i(0), e(featureDefn_->GetFieldCount()); i < e; ++i) {
+        v.Clear();
+        if (!fieldValue(*feature, i, v)) { continue; }
+        f.add_tags(key(i));
+        f.add_tags(value(v));
+    }
+
+    return OGRERR_NONE;
+}
+
+MvtDataset::MvtDataset(const std::shared_ptr<const vector_tile::Tile> &tile
+                       , const boost::optional<geo::SrsDefinition> &srs
+                       , const boost::optional<math::Extents2> &extents
+                       , bool noFields, bool raw
+                       , const boost::optional<geo::SrsDefinition>
+                       &targetSrs)
+    : tile_(tile), srs_(srs), extents_(extents)
+    , noFields_(noFields), trusted_(false), raw_(raw), targetSrs_(targetSrs)
+    , layers_(tile_->layers_size()), extent_(4096)
+{
+    if (srs_ && targetSrs_) {
+        auto src(srs_->reference());
+        auto dst(targetSrs_->reference());
+        ct_.reset(::OGRCreateCoordinateTransformation(&src, &dst));
+    }
+}
+
+MvtDataset::~MvtDataset()
+{
+    // destructor is the only place the tile is written, make failure
+    // visible to the caller closing the dataset
+    if (!output_.empty() && !save()) {
+        CPLError(CE_Failure, CPLE_FileIO
+                 , "MVT tile <%s> has not been written.", output_.c_str());
+    }
+}
+
+int MvtDataset::GetLayerCount()
+{
+    if (!output_.empty()) { return writers_.size(); }
+    return layers_.size();
+}
+
+int MvtDataset::TestCapability(const char *cap)
+{
+    if (EQUAL(cap, ODsCCreateLayer)) { return !output_.empty(); }
+    return FALSE;
+}
+
+OGRLayer* MvtDataset::GetLayer(int l)
+{
+    if (!output_.empty()) {
+        if ((l < 0) || (l >= int(writers_.size()))) { return nullptr; }
+        return writers_[l].get();
+    }
+
+    if ((l < 0) || (l >= int(layers_.size()))) { return nullptr; }
+    auto &layer(layers_[l]);
+
+    // create if not created yet
+    if (!layer) { layer.reset(new Layer(*this, tile_->layers(l))); }
+    return layer.get();
+}
+
+bool MvtDataset::readColumns(int l, Columns &columns)
+{
+    auto *layer(static_cast<Layer*>(GetLayer(l)));
+    if (!layer) {
+        CPLError(CE_Failure, CPLE_IllegalArg
+                 , "Invalid MVT layer index %d.", l);
+        return false;
     }
 
     try {
-        // set geometry
-        auto geometry(generateGeometry(feature, trafo_));
-        if (srs_) { geometry->assignSpatialReference(srs_.get()); }
-        of->SetGeometryDirectly(geometry.release());
+        layer->read(columns);
     } catch (const std::exception &e) {
         CPLError(CE_Failure, CPLE_AssertionFailed
                  , "Error processing feature's geometry: <%s>."
                  , e.what());
+        return false;
+    }
+    return true;
+}
+
+OGRLayer* MvtDataset::GetLayerByName(const char *name)
+{
+    if (!output_.empty()) {
+        for (const auto &writer : writers_) {
+            if (EQUAL(writer->GetName(), name)) { return writer.get(); }
+        }
+        return nullptr;
+    }
+
+    auto ilayers(layers_.begin());
+    for (const auto &l : tile_->layers()) {
+        if (l.name() == name) {
+            // create if not created yet
+            if (!*ilayers) { ilayers->reset(new Layer(*this, l)); }
+            return ilayers->get();
+
+        }
+        ++ilayers;
+    }
+    // not found
+    return nullptr;
+}
+
+#if GDAL_VERSION_NUM >= 3090000
+::OGRLayer* MvtDataset::ICreateLayer(const char *name
+                                     , const ::OGRGeomFieldDefn *geomField
+                                     , CSLConstList options)
+{
+    return createLayer(name, (geomField ? geomField->GetSpatialRef() : nullptr)
+                       , const_cast<char**>(options));
+}
+#else
+::OGRLayer* MvtDataset::ICreateLayer(const char *name
+                                     , ::OGRSpatialReference *srs
+                                     , ::OGRwkbGeometryType
+                                     , char **options)
+{
+    return createLayer(name, srs, options);
+}
+#endif
+
+::OGRLayer* MvtDataset::createLayer(const char *name
+                                    , const ::OGRSpatialReference *srs
+                                    , char **options)
+{
+    if (output_.empty()) {
+        CPLError(CE_Failure, CPLE_NotSupported
+                 , "MVT dataset opened for reading cannot be written to.");
+        return nullptr;
+    }
+
+    if (GetLayerByName(name)) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "Layer <%s> already exists.", name);
+        return nullptr;
+    }
+
+    const auto extent(std::atoi(::CSLFetchNameValueDef
+                                (options, "EXTENT"
+                                 , std::to_string(extent_).c_str())));
+    if (extent <= 0) {
+        CPLError(CE_Failure, CPLE_IllegalArg
+                 , "Invalid layer extent for layer <%s>.", name);
+        return nullptr;
+    }
+
+    auto &layer(*created_->add_layers());
+    layer.set_version(2);
+    layer.set_name(name);
+    layer.set_extent(extent);
+
+    // dataset SRS wins, layer's SRS is kept only for reporting
+    std::shared_ptr< ::OGRSpatialReference> layerSrs;
+    if (srs_) {
+        layerSrs = std::make_shared< ::OGRSpatialReference>
+            (srs_->reference());
+    } else if (srs) {
+        layerSrs = std::make_shared< ::OGRSpatialReference>(*srs);
+    }
+
+    writers_.emplace_back(new Writer(*this, layer, layerSrs));
+    return writers_.back().get();
+}
+
+bool isRemotePath(const char *path)
+{
+    return ((ba::istarts_with(path, "http:")
+             || ba::istarts_with(path, "https:")
+             || ba::istarts_with(path, "ftp:")));
+}
+
+bool isRemoteMvt(::GDALOpenInfo *openInfo)
+{
+    // protocol prefix and .mvt -> could be mvt
+    if (isRemotePath(openInfo->pszFilename)) {
+        if (ba::icontains(openInfo->pszFilename, ".mvt")) { return true; }
+        if (ba::icontains(openInfo->pszFilename, ".vector.pbf")) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isMbTilesArchive(::GDALOpenInfo *openInfo)
+{
+    return ba::icontains(openInfo->pszFilename, ".mbtiles/");
+}
+
+/** Applies SQLite tuning open options (if any) to given MBTiles archive.
+ */
+void configureArchive(const std::string &archive, char **options)
+{
+    if (auto readOptions = detail::MbTilesReadOptions::parse(options)) {
+        detail::configureMbTilesArchive(archive, *readOptions);
+    }
+}
+
+/** Whole MBTiles archive, opened as mosaic over one zoom level.
+ */
+bool isWholeMbTilesArchive(::GDALOpenInfo *openInfo)
+{
+    return ba::iends_with(openInfo->pszFilename, ".mbtiles");
+}
+
+const char* isMosaicPath(::GDALOpenInfo *openInfo)
+{
+    if (!ba::starts_with(openInfo->pszFilename, "mvt:mosaic:")) {
+        return nullptr;
+    }
+    return openInfo->pszFilename + 11;
+}
+
+const char* isMvtPath(::GDALOpenInfo *openInfo)
+{
+    if (!ba::starts_with(openInfo->pszFilename, "mvt:")) {
+        return nullptr;
+    }
+    return openInfo->pszFilename + 4;
+}
+
+int MvtDataset::Identify(::GDALOpenInfo *openInfo)
+{
+    if (isRemoteMvt(openInfo)) { return true; }
+
+    if (isMbTilesArchive(openInfo)) { return true; }
+
+    if (isWholeMbTilesArchive(openInfo)) { return true; }
+
+    // TODO: try to decode
+
+    // let the rest of machinery decode
+    return true;
+}
+
+bool isVsiPath(const char *path)
+{
+    return ba::starts_with(path, "/vsi");
+}
+
+/** Parses tile from memory. Protobuf takes size as int: larger input is
+ *  rejected instead of being silently truncated.
+ */
+bool parseTile(vector_tile::Tile &tile, const void *data, std::uint64_t size
+               , const char *path)
+{
+    if (size > std::uint64_t(std::numeric_limits<int>::max())) {
+        CPLError(CE_Failure, CPLE_NotSupported
+                 , "MVT tile <%s> is too large (%llu bytes)."
+                 , path, static_cast<unsigned long long>(size));
+        return false;
+    }
+    return tile.ParseFromArray(data, int(size));
+}
+
+/** Last CPL error message, used to pass VSI (e.g. HTTP) failure details on.
+ */
+std::string lastErrorMessage()
+{
+    const char *msg(::CPLGetLastErrorMsg());
+    return (msg && *msg) ? msg : "no details available";
+}
+
+/** Reads whole file via GDAL's virtual filesystem.
+ */
+bool loadFromVsi(vector_tile::Tile &tile, const char *path)
+{
+    struct Data {
+        Data() : data(), size() {}
+        ~Data() { ::VSIFree(data); }
+        ::GByte *data;
+        ::vsi_l_offset size;
+    } data;
+
+    ::CPLErrorReset();
+    if (!::VSIIngestFile(nullptr, path, &data.data, &data.size, -1)) {
+        const auto msg(lastErrorMessage());
+        CPLError(CE_Failure, CPLE_OpenFailed,
+                 "Unable to read tile <%s>: %s", path, msg.c_str());
+        return false;
+    }
+
+    return parseTile(tile, data.data, data.size, path);
+}
+
+/** Maps local file to memory and parses tile directly from mapped bytes.
+ */
+bool loadFromLocal(vector_tile::Tile &tile, const char *path)
+{
+    struct File {
+        File(const char *path) : fd(::open(path, O_RDONLY)) {}
+        ~File() { if (fd >= 0) { ::close(fd); } }
+        int fd;
+    } file(path);
+
+    if (file.fd < 0) {
+        CPLError(CE_Failure, CPLE_OpenFailed
+                 , "Unable to open file <%s>.", path);
+        return false;
+    }
+
+    struct ::stat st;
+    if (::fstat(file.fd, &st) == -1) {
+        CPLError(CE_Failure, CPLE_FileIO
+                 , "Unable to stat file <%s>.", path);
+        return false;
+    }
+
+    // empty file is an empty tile
+    if (!st.st_size) { return tile.ParseFromArray(nullptr, 0); }
+
+    // do not even map what cannot be parsed
+    if (std::uint64_t(st.st_size)
+        > std::uint64_t(std::numeric_limits<int>::max()))
+    {
+        return parseTile(tile, nullptr, st.st_size, path);
+    }
+
+    struct Mapping {
+        Mapping(int fd, std::size_t size)
+            : size(size)
+            , data(::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0))
+        {}
+        ~Mapping() { if (data != MAP_FAILED) { ::munmap(data, size); } }
+        std::size_t size;
+        void *data;
+    } mapping(file.fd, st.st_size);
+
+    if (mapping.data == MAP_FAILED) {
+        CPLError(CE_Failure, CPLE_FileIO
+                 , "Unable to map file <%s> to memory.", path);
+        return false;
+    }
+
+    // whole file is parsed front to back
+    ::madvise(mapping.data, mapping.size, MADV_SEQUENTIAL);
+
+    return parseTile(tile, mapping.data, mapping.size, path);
+}
+
+/** Remote tiles are read via /vsicurl/ to get connection reuse and caching.
+ *  Stat is issued first (its result is cached by /vsicurl/) so that missing
+ *  tile is reported as such; HTTP status text is taken from the error
+ *  /vsicurl/ left behind.
+ */
+bool loadFromRemote(vector_tile::Tile &tile, const char *path)
+{
+    const std::string vsiPath(std::string("/vsicurl/") + path);
+
+    ::CPLErrorReset();
+    ::VSIStatBufL st;
+    if (::VSIStatL(vsiPath.c_str(), &st)) {
+        const auto msg(lastErrorMessage());
+        CPLError(CE_Failure, CPLE_OpenFailed,
+                 "Remote tile <%s> not found: %s", path, msg.c_str());
+        return false;
+    }
+
+    return loadFromVsi(tile, vsiPath.c_str());
+}
+
+bool loadFromFile(vector_tile::Tile &tile, const char *path)
+{
+    if (isVsiPath(path)) { return loadFromVsi(tile, path); }
+    return loadFromLocal(tile, path);
+}
+
+/** Loads tile referenced by open info. Returns null pointer on failure.
+ */
+std::shared_ptr<const vector_tile::Tile> loadTile(::GDALOpenInfo *openInfo)
+{
+    // archive tiles may be shared with other tiles in deduplicated archive
+    if (!isMvtPath(openInfo) && !isRemoteMvt(openInfo)
+        && isMbTilesArchive(openInfo))
+    {
+        try {
+            return detail::loadSharedFromMbTilesArchive(openInfo->pszFilename);
+        } catch (...) {
+            return {};
+        }
+    }
+
+    auto tile(std::make_shared<vector_tile::Tile>());
+
+    try {
+        if (auto mvtPath = isMvtPath(openInfo)) {
+            if (isRemotePath(mvtPath)) {
+                if (!loadFromRemote(*tile, mvtPath)) { return {}; }
+            } else if (!loadFromFile(*tile, mvtPath)) {
+                return {};
+            }
+        } else if (isRemoteMvt(openInfo)) {
+            if (!loadFromRemote(*tile, openInfo->pszFilename)) {
+                return {};
+            }
+        } else if (!loadFromFile(*tile, openInfo->pszFilename)) {
+            return {};
+        }
+    } catch (...) {
+        return {};
+    }
+
+    return tile;
+}
+
+typedef detail::LruCache<std::string, vector_tile::Tile> TileCache;
+
+/** Process-wide cache of decoded tiles. Budget (in bytes) is taken from
+ *  MVT_CACHE_SIZE configuration option (64 MiB by default, 0 disables the
+ *  cache) and re-read on every open.
+ */
+TileCache& tileCache()
+{
+    static TileCache cache(0);
+
+    const char *size(::CPLGetConfigOption("MVT_CACHE_SIZE", nullptr));
+    cache.budget(size ? std::strtoull(size, nullptr, 10) : (64 << 20));
+    return cache;
+}
+
+/** Canonical form of tile path used in cache keys: local files (and
+ *  archives of mbtiles paths) are resolved to real paths. Resolved local
+ *  file is stored in file (if given).
+ */
+std::string canonicalTilePath(const std::string &path
+                              , std::string *file = nullptr)
+{
+    if (ba::starts_with(path, "mvt:")) {
+        return "mvt:" + canonicalTilePath(path.substr(4), file);
+    }
+
+    if (isRemotePath(path.c_str()) || isVsiPath(path.c_str())) {
+        return path;
+    }
+
+    // local file (or mbtiles path with existing archive)
+    std::string local(path);
+    const auto archive(ba::ifind_first(path, ".mbtiles/"));
+    if (archive) { local.assign(path.begin(), archive.end() - 1); }
+    const auto tail(path.substr(local.size()));
+
+    if (char *real = ::realpath(local.c_str(), nullptr)) {
+        local = real;
+        std::free(real);
+    }
+
+    if (file) { *file = local; }
+    return local + tail;
+}
+
+/** Cache key: canonical path or URL, stamp of local file plus options
+ *  affecting interpretation.
+ */
+std::string tileCacheKey(::GDALOpenInfo *openInfo)
+{
+    std::string file;
+    auto key(canonicalTilePath(openInfo->pszFilename, &file));
+    key.push_back('\0');
+
+    // local file stamp: changed file gets new key
+    if (!file.empty()) {
+        ::VSIStatBufL st;
+        if (!::VSIStatL(file.c_str(), &st)) {
+            key += std::to_string(st.st_size);
+            key.push_back(':');
+            key += std::to_string(st.st_mtime);
+        }
+    }
+
+    auto options(openInfo->papszOpenOptions);
+    key.push_back('\0');
+    key += ::CSLFetchNameValueDef(options, "MVT_SRS", "");
+    key.push_back('\0');
+    key += ::CSLFetchNameValueDef(options, "MVT_EXTENTS", "");
+    return key;
+}
+
+/** Removes all cached decodings of given tile path.
+ */
+void invalidateCachedTile(const std::string &path)
+{
+    // tile may have been opened with or without "mvt:" prefix
+    auto prefix(canonicalTilePath(path));
+    prefix.push_back('\0');
+    const auto mvtPrefix("mvt:" + prefix);
+    tileCache().erase([&](const std::string &key)
+    {
+        return (ba::starts_with(key, prefix)
+                || ba::starts_with(key, mvtPrefix));
+    });
+}
+
+/** Parses open options shared by single tile and mosaic datasets.
+ */
+bool commonOptions(char **options
+                   , boost::optional<geo::SrsDefinition> &srs
+                   , boost::optional<math::Extents2> &extents
+                   , bool &noFields)
+{
+    if (const char *mvtSrs = ::CSLFetchNameValue(options, "MVT_SRS"))
+    {
+        try {
+            srs = geo::SrsDefinition::fromString(mvtSrs);
+        } catch (const std::exception &e) {
+            CPLError(CE_Failure, CPLE_IllegalArg
+                     , "MVT Dataset initialization failure: "
+                     "failed to parse provided open options MVT_SRS (%s)."
+                     , e.what());
+            return false;
+        }
+    }
+
+    if (const char *mvtExtents = ::CSLFetchNameValue(options, "MVT_EXTENTS"))
+    {
+        try {
+            extents = boost::lexical_cast<math::Extents2>(mvtExtents);
+        } catch (const std::exception&) {
+            CPLError(CE_Failure, CPLE_IllegalArg
+                     , "MVT Dataset initialization failure: "
+                     "failed to parse provided open options MVT_EXTENTS.");
+            return false;
+        }
+    }
+
+    noFields = ::CSLFetchBoolean(options, "MVT_NOFIELDS", false);
+    return true;
+}
+
+GDALDataset* MvtDataset::Open(::GDALOpenInfo *openInfo)
+{
+    ::CPLErrorReset();
+
+    if (auto source = isMosaicPath(openInfo)) {
+        return MvtMosaicDataset::Open(openInfo, source);
+    }
+
+    if (isWholeMbTilesArchive(openInfo)) {
+        return MvtMosaicDataset::Open(openInfo, openInfo->pszFilename, true);
+    }
+
+    // TODO: detect
+
+    if (isMbTilesArchive(openInfo)) {
+        // archive is everything before tile index
+        const char *path(openInfo->pszFilename);
+        configureArchive(std::string(path, std::strrchr(path, '/'))
+                         , openInfo->papszOpenOptions);
+    }
+
+    // open, decoded tiles are shared via cache
+    auto &cache(tileCache());
+    const auto cacheKey(tileCacheKey(openInfo));
+    auto tile(cache.get(cacheKey));
+    if (!tile) {
+        auto loaded(loadTile(openInfo));
+        if (!loaded) { return nullptr; }
+        cache.put(cacheKey, loaded, loaded->SpaceUsedLong());
+        tile = loaded;
+    }
+
+    if (openInfo->eAccess == GA_Update) {
+        CPLError(CE_Warning, CPLE_NotSupported,
+                 "MVT driver opens existing tiles read-only, "
+                 "new tiles are written via Create.");
+    }
+
+    boost::optional<geo::SrsDefinition> srs;
+    boost::optional<math::Extents2> extents;
+    bool noFields(false);
+    if (!commonOptions(openInfo->papszOpenOptions, srs, extents
+                       , noFields))
+    {
+        return nullptr;
+    }
+
+    const bool raw
+        (::CSLFetchBoolean(openInfo->papszOpenOptions, "MVT_RAW", false));
+
+    boost::optional<geo::SrsDefinition> targetSrs;
+    if (const char *mvtTargetSrs
+        = ::CSLFetchNameValue(openInfo->papszOpenOptions, "MVT_TARGET_SRS"))
+    {
+        if (!srs || raw) {
+            CPLError(CE_Failure, CPLE_IllegalArg
+                     , "MVT Dataset initialization failure: "
+                     "open option MVT_TARGET_SRS requires MVT_SRS "
+                     "and cannot be combined with MVT_RAW.");
+            return nullptr;
+        }
+
+        try {
+            targetSrs = geo::SrsDefinition::fromString(mvtTargetSrs);
+        } catch (const std::exception &e) {
+            CPLError(CE_Failure, CPLE_IllegalArg
+                     , "MVT Dataset initialization failure: "
+                     "failed to parse provided open options "
+                     "MVT_TARGET_SRS (%s).", e.what());
+            return nullptr;
+        }
+    }
+
+    // parsed tile, pass it to dataset
+    std::unique_ptr<MvtDataset> ds
+        (new MvtDataset(tile, srs, extents, noFields, raw
+                        , targetSrs));
+    ds->trusted_ = ::CSLFetchBoolean(openInfo->papszOpenOptions
+                                     , "MVT_TRUSTED", false);
+
+    const auto stats(cache.stats());
+    ds->SetMetadataItem("MVT_CACHE_HITS"
+                        , std::to_string(stats.hits).c_str());
+    ds->SetMetadataItem("MVT_CACHE_MISSES"
+                        , std::to_string(stats.misses).c_str());
+    ds->SetMetadataItem("MVT_CACHE_SIZE"
+                        , std::to_string(stats.size).c_str());
+
+    if (targetSrs && !ds->ct_) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "MVT Dataset initialization failure: "
+                 "cannot create transformation to MVT_TARGET_SRS.");
+        return nullptr;
+    }
+
+    return ds.release();
+}
+
+::GDALDataset* MvtDataset::Create(const char *path, int, int, int bands
+                                  , ::GDALDataType, char **options)
+{
+    if (bands) {
+        CPLError(CE_Failure, CPLE_NotSupported
+                 , "MVT driver supports only vector data.");
         return nullptr;
     }
 
-    // next
-    ++ifeatures_;
-    return of.release();
+    if (ba::starts_with(path, "mvt:")) { path += 4; }
+
+    boost::optional<geo::SrsDefinition> srs;
+    boost::optional<math::Extents2> extents;
+    bool noFields(false);
+    if (!commonOptions(options, srs, extents, noFields)) { return nullptr; }
+
+    const auto extent
+        (std::atoi(::CSLFetchNameValueDef(options, "MVT_EXTENT", "4096")));
+    if (extent <= 0) {
+        CPLError(CE_Failure, CPLE_IllegalArg
+                 , "MVT Dataset creation failure: invalid MVT_EXTENT.");
+        return nullptr;
+    }
+
+    if (!ba::icontains(path, ".mbtiles/")) {
+        // fail early if output file cannot be created
+        auto *f(::VSIFOpenL(path, "wb"));
+        if (!f) {
+            CPLError(CE_Failure, CPLE_OpenFailed
+                     , "Unable to create file <%s>.", path);
+            return nullptr;
+        }
+        ::VSIFCloseL(f);
+    }
+
+    auto tile(std::make_shared<vector_tile::Tile>());
+    std::unique_ptr<MvtDataset> ds
+        (new MvtDataset(tile, srs, extents, false, false, boost::none));
+    ds->created_ = tile;
+    ds->output_ = path;
+    ds->extent_ = extent;
+    ds->eAccess = GA_Update;
+    ds->SetDescription(path);
+    return ds.release();
+}
+
+bool MvtDataset::save()
+{
+    std::string data;
+    if (!tile_->SerializeToString(&data)) {
+        CPLError(CE_Failure, CPLE_AppDefined
+                 , "Unable to serialize MVT tile <%s>.", output_.c_str());
+        return false;
+    }
+
+    const bool ok(write(data));
+
+    // whatever has been cached for this path is stale now
+    invalidateCachedTile(output_);
+    return ok;
+}
+
+bool MvtDataset::write(const std::string &data)
+{
+    if (ba::icontains(output_, ".mbtiles/")) {
+        return detail::saveToMbTilesArchive(data, output_.c_str());
+    }
+
+    auto *f(::VSIFOpenL(output_.c_str(), "wb"));
+    if (!f) {
+        CPLError(CE_Failure, CPLE_OpenFailed
+                 , "Unable to create file <%s>.", output_.c_str());
+        return false;
+    }
+
+    const bool ok(::VSIFWriteL(data.data(), 1, data.size(), f)
+                  == data.size());
+    if ((::VSIFCloseL(f) != 0) || !ok) {
+        CPLError(CE_Failure, CPLE_FileIO
+                 , "Unable to write file <%s>.", output_.c_str());
+        return false;
+    }
+    return true;
+}
+
+// mosaic
+
+class MvtMosaicDataset::TileSource {
+public:
+    typedef std::shared_ptr<TileSource> pointer;
+
+    /** Tile to load. Data (and tile ID of deduplicated archive) are filled
+     *  in by sources reading tiles in bulk.
+     */
+    struct Request {
+        int x;
+        int y;
+        std::string data;
+        std::string tileId;
+
+        Request(int x = 0, int y = 0) : x(x), y(y) {}
+    };
+
+    typedef std::function<bool(Request&)> Walker;
+
+    virtual ~TileSource() {}
+
+    /** Loads tile, row is counted from top. Returns false if tile is not
+     *  available. Called concurrently from worker threads.
+     */
+    virtual bool load(vector_tile::Tile &tile, unsigned int zoom
+                      , unsigned int x, unsigned int y) const = 0;
+
+    /** Loads requested tile. Returns null pointer if tile is not
+     *  available. Called concurrently from worker threads.
+     */
+    virtual std::shared_ptr<const vector_tile::Tile>
+    load(unsigned int zoom, const Request &request) const
+    {
+        auto tile(std::make_shared<vector_tile::Tile>());
+        if (!load(*tile, zoom, request.x, request.y)) { return {}; }
+        return tile;
+    }
+
+    /** Returns walker over all tiles in inclusive range. Tiles are walked
+     *  row by row; if rowMajor is not set source can use any order.
+     */
+    virtual Walker walk(unsigned int zoom, const math::Extents2i &range
+                        , bool rowMajor) const;
+};
+
+namespace {
+
+/** Walks inclusive tile range row by row.
+ */
+class TileWalker {
+public:
+    TileWalker(const math::Extents2i &range)
+        : range_(range), x_(range.ll(0)), y_(range.ll(1))
+    {}
+
+    bool operator()(MvtMosaicDataset::TileSource::Request &request) {
+        if ((range_.ll(0) > range_.ur(0)) || (y_ > range_.ur(1))) {
+            return false;
+        }
+
+        request = MvtMosaicDataset::TileSource::Request(x_, y_);
+        if (++x_ > range_.ur(0)) {
+            x_ = range_.ll(0);
+            ++y_;
+        }
+        return true;
+    }
+
+private:
+    math::Extents2i range_;
+    int x_;
+    int y_;
+};
+
+} // namespace
+
+MvtMosaicDataset::TileSource::Walker
+MvtMosaicDataset::TileSource::walk(unsigned int, const math::Extents2i &range
+                                   , bool) const
+{
+    return TileWalker(range);
+}
+
+namespace {
+
+/** Path or URL template with {z}, {x} and {y} placeholders.
+ */
+class TemplateTileSource : public MvtMosaicDataset::TileSource {
+public:
+    TemplateTileSource(const std::string &tmpl)
+        : tmpl_(tmpl), remote_(isRemotePath(tmpl.c_str()))
+    {}
+
+    using MvtMosaicDataset::TileSource::load;
+
+    virtual bool load(vector_tile::Tile &tile, unsigned int zoom
+                      , unsigned int x, unsigned int y) const
+    {
+        auto path(tmpl_);
+        ba::replace_all(path, "{z}", std::to_string(zoom));
+        ba::replace_all(path, "{x}", std::to_string(x));
+        ba::replace_all(path, "{y}", std::to_string(y));
+
+        if (remote_) { return loadFromRemote(tile, path.c_str()); }
+        return loadFromFile(tile, path.c_str());
+    }
+
+    static bool valid(const char *tmpl) {
+        return (ba::contains(tmpl, "{z}") && ba::contains(tmpl, "{x}")
+                && ba::contains(tmpl, "{y}"));
+    }
+
+private:
+    const std::string tmpl_;
+    const bool remote_;
+};
+
+/** MBTiles archive. Tiles are streamed by single query, only existing tiles
+ *  are visited.
+ */
+class MbTilesTileSource : public MvtMosaicDataset::TileSource {
+public:
+    MbTilesTileSource(const std::string &archive) : archive_(archive) {}
+
+    virtual bool load(vector_tile::Tile &tile, unsigned int zoom
+                      , unsigned int x, unsigned int y) const
+    {
+        return detail::loadFromMbTilesArchive
+            (tile, archive_, zoom, x, y, false);
+    }
+
+    virtual std::shared_ptr<const vector_tile::Tile>
+    load(unsigned int, const Request &request) const
+    {
+        return detail::decodeSharedMbTile(archive_, request.tileId
+                                          , request.data.data()
+                                          , request.data.size());
+    }
+
+    virtual Walker walk(unsigned int zoom, const math::Extents2i &range
+                        , bool rowMajor) const
+    {
+        if ((range.ll(0) > range.ur(0)) || (range.ll(1) > range.ur(1))) {
+            return [](Request&) { return false; };
+        }
+
+        auto cursor(std::make_shared<detail::MbTilesCursor>
+                    (archive_, zoom, range.ll(0), range.ll(1)
+                     , range.ur(0), range.ur(1), rowMajor));
+
+        return [cursor](Request &request) -> bool
+        {
+            unsigned int x, y;
+            if (!cursor->next(x, y, request.data, &request.tileId)) {
+                return false;
+            }
+            request.x = x;
+            request.y = y;
+            return true;
+        };
+    }
+
+private:
+    const std::string archive_;
+};
+
+struct TileId {
+    int x;
+    int y;
+
+    TileId(int x = 0, int y = 0) : x(x), y(y) {}
+};
+
+/** Loaded and decoded tile, tile is null if not available.
+ */
+struct LoadedTile {
+    TileId id;
+    std::shared_ptr<const vector_tile::Tile> tile;
+};
+
+typedef detail::Prefetcher<MvtMosaicDataset::TileSource::Request, LoadedTile>
+TilePrefetcher;
+
+/** Starts loading tiles in given range. Tiles found in decoded are not
+ *  loaded again. Nonzero limit caps number of walked tiles.
+ */
+std::unique_ptr<TilePrefetcher>
+prefetchTiles(const MvtMosaicDataset::TileSource::pointer &source
+              , const MvtMosaicDataset::Config &config
+              , const math::Extents2i &range
+              , const std::shared_ptr<const MvtMosaicDataset::DecodedTiles>
+              &decoded = {}
+              , std::size_t limit = 0)
+{
+    const auto zoom(config.zoom);
+    const auto process([source, zoom, decoded]
+                       (const MvtMosaicDataset::TileSource::Request &request
+                        , LoadedTile &loaded)
+    {
+        loaded.id = TileId(request.x, request.y);
+
+        if (decoded) {
+            auto fdecoded(decoded->find({ request.x, request.y }));
+            if (fdecoded != decoded->end()) {
+                loaded.tile = fdecoded->second;
+                return;
+            }
+        }
+
+        // missing tiles are expected, keep errors quiet
+        ::CPLPushErrorHandler(::CPLQuietErrorHandler);
+        try {
+            loaded.tile = source->load(zoom, request);
+        } catch (...) {}
+        ::CPLPopErrorHandler();
+    });
+
+    // stitching needs tiles row by row
+    auto walker(source->walk(zoom, range, config.stitch));
+    if (limit) {
+        // walker is called serialized
+        walker = [walker, limit]
+            (MvtMosaicDataset::TileSource::Request &request) mutable
+        {
+            if (!limit) { return false; }
+            --limit;
+            return walker(request);
+        };
+    }
+
+    return std::unique_ptr<TilePrefetcher>
+        (new TilePrefetcher(walker, process
+                            , config.threads, config.lookahead));
+}
+
+/** Extents of given tile, derived from root tile extents.
+ */
+math::Extents2 tileExtents(const MvtMosaicDataset::Config &config
+                           , const TileId &id)
+{
+    const auto size(math::size(config.extents));
+    const double tiles(1u << config.zoom);
+    const double w(size.width / tiles);
+    const double h(size.height / tiles);
+    const auto ul(math::ul(config.extents));
+
+    return math::Extents2(ul(0) + id.x * w, ul(1) - (id.y + 1) * h
+                          , ul(0) + (id.x + 1) * w, ul(1) - id.y * h);
+}
+
+/** Range of tiles intersecting given envelope, clipped to mosaic range.
+ */
+math::Extents2i tileRange(const MvtMosaicDataset::Config &config
+                          , const ::OGREnvelope &e)
+{
+    const auto size(math::size(config.extents));
+    const double tiles(1u << config.zoom);
+    const double w(size.width / tiles);
+    const double h(size.height / tiles);
+    const auto ul(math::ul(config.extents));
+    const auto &r(config.tiles);
+
+    const auto index([](double value, int min, int max) -> int
+    {
+        value = std::floor(value);
+        if (value < min) { return min; }
+        if (value > max) { return max; }
+        return int(value);
+    });
+
+    // clamp one tile outside the range to keep empty ranges empty
+    return math::Extents2i
+        (index((e.MinX - ul(0)) / w, r.ll(0), r.ur(0) + 1)
+         , index((ul(1) - e.MaxY) / h, r.ll(1), r.ur(1) + 1)
+         , index((e.MaxX - ul(0)) / w, r.ll(0) - 1, r.ur(0))
+         , index((ul(1) - e.MinY) / h, r.ll(1) - 1, r.ur(1)));
+}
+
+/** Tile extent of the integer space fragments are stitched in. Every tile
+ *  layer is rescaled to it, so tiles with different extents merge correctly.
+ */
+const double stitchExtent(4096.0);
+
+/** Fragments of one feature collected from several tiles. Geometries are in
+ *  integer space of the zoom level (see stitchExtent).
+ */
+struct Fragments {
+    /** First fragment, provides attributes.
+     */
+    std::unique_ptr< ::OGRFeature> feature;
+    std::vector<std::unique_ptr< ::OGRGeometry>> geometries;
+
+    /** Last tile row the feature was seen in.
+     */
+    int lastRow;
+
+    /** Order of first appearance.
+     */
+    std::size_t order;
+
+    Fragments() : lastRow(), order() {}
+};
+
+/** Tile bounds in integer space of the zoom level.
+ */
+std::unique_ptr< ::OGRPolygon> tileRectangle(const TileId &id, double extent)
+{
+    const double x1(id.x * extent), x2((id.x + 1) * extent);
+    const double y1(id.y * extent), y2((id.y + 1) * extent);
+
+    std::unique_ptr< ::OGRLinearRing> ring(new ::OGRLinearRing());
+    ring->addPoint(x1, y1);
+    ring->addPoint(x2, y1);
+    ring->addPoint(x2, y2);
+    ring->addPoint(x1, y2);
+    ring->addPoint(x1, y1);
+
+    std::unique_ptr< ::OGRPolygon> polygon(new ::OGRPolygon());
+    polygon->addRingDirectly(ring.release());
+    return polygon;
+}
+
+/** Applies transformation to every vertex of given geometry.
+ */
+void transformGeometry(::OGRGeometry &geometry, const Trafo &trafo
+                       , Coordinates &coords)
+{
+    switch (::wkbFlatten(geometry.getGeometryType())) {
+    case ::wkbPoint: {
+        auto &point(static_cast< ::OGRPoint&>(geometry));
+        double x(point.getX()), y(point.getY());
+        trafo(1, &x, &y);
+        point.setX(x);
+        point.setY(y);
+        break;
+    }
+
+    case ::wkbLineString:
+    case ::wkbLinearRing: {
+        auto &curve(static_cast< ::OGRSimpleCurve&>(geometry));
+        const auto count(curve.getNumPoints());
+        coords.resize(count);
+        curve.getPoints(coords.x.data(), sizeof(double)
+                        , coords.y.data(), sizeof(double));
+        trafo(count, coords.x.data(), coords.y.data());
+        curve.setPoints(count, coords.x.data(), coords.y.data());
+        break;
+    }
+
+    case ::wkbPolygon: {
+        auto &polygon(static_cast< ::OGRPolygon&>(geometry));
+        if (auto *ring = polygon.getExteriorRing()) {
+            transformGeometry(*ring, trafo, coords);
+        }
+        for (int i(0), e(polygon.getNumInteriorRings()); i < e; ++i) {
+            transformGeometry(*polygon.getInteriorRing(i), trafo, coords);
+        }
+        break;
+    }
+
+    case ::wkbMultiPoint:
+    case ::wkbMultiLineString:
+    case ::wkbMultiPolygon:
+    case ::wkbGeometryCollection: {
+        auto &collection(static_cast< ::OGRGeometryCollection&>(geometry));
+        for (int i(0), e(collection.getNumGeometries()); i < e; ++i) {
+            transformGeometry(*collection.getGeometryRef(i), trafo, coords);
+        }
+        break;
+    }
+
+    default:
+        LOGTHROW(err1, std::runtime_error)
+            << "Unsupported geometry type in stitched feature.";
+    }
+}
+
+inline bool isPolygonal(const ::OGRGeometry &geometry)
+{
+    const auto type(::wkbFlatten(geometry.getGeometryType()));
+    return ((type == ::wkbPolygon) || (type == ::wkbMultiPolygon));
+}
+
+/** Merges fragments into single geometry. Polygons are merged by cascaded
+ *  union, other geometries by pairwise union.
+ */
+std::unique_ptr< ::OGRGeometry>
+mergeGeometries(std::vector<std::unique_ptr< ::OGRGeometry>> &geometries)
+{
+    if (geometries.size() == 1) { return std::move(geometries.front()); }
+
+    if (std::all_of(geometries.begin(), geometries.end()
+                    , [](const std::unique_ptr< ::OGRGeometry> &g) {
+                        return isPolygonal(*g);
+                    }))
+    {
+        std::unique_ptr< ::OGRMultiPolygon> parts(new ::OGRMultiPolygon());
+        for (auto &geometry : geometries) {
+            if (::wkbFlatten(geometry->getGeometryType()) == ::wkbPolygon) {
+                parts->addGeometryDirectly(geometry.release());
+                continue;
+            }
+
+            const auto &mp(static_cast< ::OGRMultiPolygon&>(*geometry));
+            for (int i(0), e(mp.getNumGeometries()); i < e; ++i) {
+                parts->addGeometry(mp.getGeometryRef(i));
+            }
+        }
+
+        if (auto *merged = parts->UnionCascaded()) {
+            return std::unique_ptr< ::OGRGeometry>(merged);
+        }
+
+        // invalid input, return parts as they are
+        return std::unique_ptr< ::OGRGeometry>(parts.release());
+    }
+
+    std::unique_ptr< ::OGRGeometry> merged(std::move(geometries.front()));
+    for (std::size_t i(1); i < geometries.size(); ++i) {
+        if (auto *u = merged->Union(geometries[i].get())) { merged.reset(u); }
+    }
+    return merged;
 }
 
-MvtDataset::MvtDataset(std::unique_ptr<vector_tile::Tile> tile
-                       , const boost::optional<geo::SrsDefinition> &srs
-                       , const boost::optional<math::Extents2> &extents
-                       , bool noFields)
-    : tile_(std::move(tile)), srs_(srs), extents_(extents)
-    , noFields_(noFields), layers_(tile_->layers_size())
-{}
+const char *webMercatorSrs
+    ("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0"
+     " +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs");
 
-OGRLayer* MvtDataset::GetLayer(int l)
+math::Extents2 webMercatorExtents()
 {
-    if ((l < 0) || (l >= int(layers_.size()))) { return nullptr; }
-    auto &layer(layers_[l]);
-
-    // create if not created yet
-    if (!layer) { layer.reset(new Layer(*this, tile_->layers(l))); }
-    return layer.get();
+    const double half(20037508.342789244);
+    return math::Extents2(-half, -half, half, half);
 }
 
-OGRLayer* MvtDataset::GetLayerByName(const char *name)
+/** Converts MBTiles bounds (west,south,east,north in degrees) to range of
+ *  tiles at given zoom level.
+ */
+boost::optional<math::Extents2i> boundsTileRange(const char *bounds
+                                                 , unsigned int zoom)
 {
-    auto ilayers(layers_.begin());
-    for (const auto &l : tile_->layers()) {
-        if (l.name() == name) {
-            // create if not created yet
-            if (!*ilayers) { ilayers->reset(new Layer(*this, l)); }
-            return ilayers->get();
+    double w, s, e, n;
+    if (std::sscanf(bounds, "%lf,%lf,%lf,%lf", &w, &s, &e, &n) != 4) {
+        return boost::none;
+    }
 
-        }
-        ++ilayers;
+    const double tiles(1u << zoom);
+    const int max((1 << zoom) - 1);
+
+    const auto clamp([max](double value) -> int
+    {
+        value = std::floor(value);
+        if (value < 0) { return 0; }
+        if (value > max) { return max; }
+        return int(value);
+    });
+
+    const auto x([&](double lon) { return clamp((lon + 180.0) / 360.0
+                                                * tiles); });
+    const auto y([&](double lat) -> int {
+        // clamp to mercator range
+        lat = std::max(-85.0511287798, std::min(85.0511287798, lat));
+        const auto rad(lat * M_PI / 180.0);
+        return clamp((1.0 - std::log(std::tan(rad) + 1.0 / std::cos(rad))
+                      / M_PI) / 2.0 * tiles);
+    });
+
+    return math::Extents2i(x(w), y(n), x(e), y(s));
+}
+
+const vector_tile::Tile_Layer* findLayer(const vector_tile::Tile &tile
+                                         , const char *name)
+{
+    for (const auto &layer : tile.layers()) {
+        if (layer.name() == name) { return &layer; }
     }
-    // not found
     return nullptr;
 }
 
-bool isRemotePath(const char *path)
+} // namespace
+
+class MvtMosaicDataset::Layer : public ::OGRLayer
 {
-    return ((ba::istarts_with(path, "http:")
-             || ba::istarts_with(path, "https:")
-             || ba::istarts_with(path, "ftp:")));
+public:
+    Layer(MvtMosaicDataset &ds, ::OGRFeatureDefn *featureDefn)
+        : ds_(ds), featureDefn_(featureDefn)
+        , keyField_(featureDefn_->GetFieldIndex
+                    (ds_.config_.stitchKey.c_str()))
+        , row_(-1), eof_(false), order_()
+    {
+        featureDefn_->Reference();
+    }
+
+    virtual ~Layer() {
+        ResetReading();
+        featureDefn_->Release();
+    }
+
+    virtual ::OGRSpatialReference* GetSpatialRef() { return ds_.srs_.get(); }
+    virtual void ResetReading();
+    virtual ::OGRFeature* GetNextFeature();
+    virtual ::OGRFeatureDefn* GetLayerDefn() { return featureDefn_; }
+    virtual int TestCapability(const char *cap);
+    virtual const char* GetName() { return featureDefn_->GetName(); }
+
+    using ::OGRLayer::SetSpatialFilter;
+    virtual void SetSpatialFilter(::OGRGeometry *geometry);
+    virtual ::OGRErr SetAttributeFilter(const char *query);
+
+private:
+    /** Fetches next tile. Returns false when there are no more tiles.
+     */
+    bool nextTile(LoadedTile &loaded);
+
+    ::OGRFeature* nextStitched();
+
+    /** Clips feature to current tile and adds it to its group.
+     */
+    void addFragment(std::unique_ptr< ::OGRFeature> feature);
+
+    /** Moves groups last seen before given row to ready queue.
+     */
+    void flush(int row);
+
+    /** Merges fragments and converts geometry to world coordinates.
+     */
+    std::unique_ptr< ::OGRFeature> finish(Fragments &fragments);
+
+    MvtMosaicDataset &ds_;
+    ::OGRFeatureDefn *featureDefn_;
+
+    /** Field used as stitching key, -1 to use feature ID.
+     */
+    int keyField_;
+
+    /** Attribute filter passed to every tile layer.
+     */
+    std::string attributeFilter_;
+
+    std::unique_ptr<TilePrefetcher> prefetcher_;
+
+    /** Currently read tile and its layer.
+     */
+    std::shared_ptr<const vector_tile::Tile> tile_;
+    std::unique_ptr<MvtDataset::Layer> tileLayer_;
+
+    // stitching state
+    TileId tileId_;
+    int row_;
+    bool eof_;
+    std::size_t order_;
+    std::unordered_map<std::string, Fragments> pending_;
+
+    /** Keys of features emitted from recently flushed rows mapped to the
+     *  last row they were seen in; kept only for a few rows.
+     */
+    std::unordered_map<std::string, int> emitted_;
+    std::deque<std::unique_ptr< ::OGRFeature>> ready_;
+    Coordinates coords_;
+};
+
+void MvtMosaicDataset::Layer::ResetReading()
+{
+    tileLayer_.reset();
+    tile_.reset();
+    prefetcher_.reset();
+
+    pending_.clear();
+    emitted_.clear();
+    ready_.clear();
+    row_ = -1;
+    eof_ = false;
+    order_ = 0;
 }
 
-bool isRemoteMvt(::GDALOpenInfo *openInfo)
+int MvtMosaicDataset::Layer::TestCapability(const char *cap)
 {
-    // protocol prefix and .mvt -> could be mvt
-    if (isRemotePath(openInfo->pszFilename)) {
-        if (ba::icontains(openInfo->pszFilename, ".mvt")) { return true; }
-        if (ba::icontains(openInfo->pszFilename, ".vector.pbf")) {
-            return true;
-        }
+    if (EQUAL(cap, OLCFastSpatialFilter)) { return TRUE; }
+    return FALSE;
+}
+
+void MvtMosaicDataset::Layer::SetSpatialFilter(::OGRGeometry *geometry)
+{
+    if (InstallFilter(geometry)) { ResetReading(); }
+}
+
+::OGRErr MvtMosaicDataset::Layer::SetAttributeFilter(const char *query)
+{
+    const auto err(::OGRLayer::SetAttributeFilter(query));
+    if (err != OGRERR_NONE) { return err; }
+
+    attributeFilter_ = m_poAttrQuery ? query : "";
+    ResetReading();
+    return err;
+}
+
+bool MvtMosaicDataset::Layer::nextTile(LoadedTile &loaded)
+{
+    if (!prefetcher_) {
+        // start loading tiles; when not stitching, skip tiles outside
+        // spatial filter
+        prefetcher_ = prefetchTiles
+            (ds_.source_, ds_.config_
+             , ((m_poFilterGeom && !ds_.config_.stitch)
+                ? tileRange(ds_.config_, m_sFilterEnvelope)
+                : ds_.config_.tiles)
+             , ds_.decoded_);
     }
 
-    return false;
+    return prefetcher_->next(loaded);
 }
 
-bool isMbTilesArchive(::GDALOpenInfo *openInfo)
+::OGRFeature* MvtMosaicDataset::Layer::GetNextFeature()
 {
-    return ba::icontains(openInfo->pszFilename, ".mbtiles/");
+    if (ds_.config_.stitch) { return nextStitched(); }
+
+    for (;;) {
+        if (tileLayer_) {
+            if (auto *feature = tileLayer_->GetNextFeature()) {
+                return feature;
+            }
+            tileLayer_.reset();
+            tile_.reset();
+        }
+
+        LoadedTile loaded;
+        if (!nextTile(loaded)) { return nullptr; }
+        if (!loaded.tile) { continue; }
+
+        const auto *layer(findLayer(*loaded.tile, GetName()));
+        if (!layer) { continue; }
+
+        tile_ = loaded.tile;
+        tileLayer_.reset(new MvtDataset::Layer
+                         (*layer, featureDefn_
+                          , Trafo(layer->extent()
+                                  , tileExtents(ds_.config_, loaded.id))
+                          , ds_.srs_, ds_.config_.noFields
+                          , ds_.config_.trusted));
+
+        // let tile layer do the filtering
+        if (m_poFilterGeom) { tileLayer_->SetSpatialFilter(m_poFilterGeom); }
+        if (!attributeFilter_.empty()) {
+            tileLayer_->SetAttributeFilter(attributeFilter_.c_str());
+        }
+    }
 }
 
-const char* isMvtPath(::GDALOpenInfo *openInfo)
+::OGRFeature* MvtMosaicDataset::Layer::nextStitched()
 {
-    if (!ba::starts_with(openInfo->pszFilename, "mvt:")) {
-        return nullptr;
+    for (;;) {
+        if (!ready_.empty()) {
+            std::unique_ptr< ::OGRFeature> feature(std::move(ready_.front()));
+            ready_.pop_front();
+
+            if (m_poFilterGeom && !FilterGeometry(feature->GetGeometryRef()))
+            {
+                continue;
+            }
+            return feature.release();
+        }
+
+        if (eof_) { return nullptr; }
+
+        if (tileLayer_) {
+            if (auto *feature = tileLayer_->GetNextFeature()) {
+                addFragment(std::unique_ptr< ::OGRFeature>(feature));
+                continue;
+            }
+            tileLayer_.reset();
+            tile_.reset();
+        }
+
+        LoadedTile loaded;
+        if (!nextTile(loaded)) {
+            // no more tiles, everything is complete
+            flush(std::numeric_limits<int>::max());
+            eof_ = true;
+            continue;
+        }
+
+        if (loaded.id.y != row_) {
+            // new row: features not seen in previous row are complete
+            flush(loaded.id.y - 1);
+            row_ = loaded.id.y;
+        }
+
+        if (!loaded.tile) { continue; }
+
+        const auto *layer(findLayer(*loaded.tile, GetName()));
+        if (!layer) { continue; }
+
+        if (!layer->extent()) { continue; }
+
+        tile_ = loaded.tile;
+        tileId_ = loaded.id;
+
+        // generate geometries in common integer space of the zoom level
+        const double scale(stitchExtent / layer->extent());
+        const math::Point2d shift(tileId_.x * stitchExtent
+                                  , tileId_.y * stitchExtent);
+        tileLayer_.reset(new MvtDataset::Layer
+                         (*layer, featureDefn_
+                          , Trafo(shift, math::Size2f(scale, scale))
+                          , std::shared_ptr< ::OGRSpatialReference>()
+                          , ds_.config_.noFields, ds_.config_.trusted));
+
+        // spatial filter is applied to stitched features
+        if (!attributeFilter_.empty()) {
+            tileLayer_->SetAttributeFilter(attributeFilter_.c_str());
+        }
     }
-    return openInfo->pszFilename + 4;
 }
 
-int MvtDataset::Identify(::GDALOpenInfo *openInfo)
+void MvtMosaicDataset::Layer::addFragment(std::unique_ptr< ::OGRFeature>
+                                          feature)
 {
-    if (isRemoteMvt(openInfo)) { return true; }
+    std::unique_ptr< ::OGRGeometry> geometry(feature->StealGeometry());
+    if (!geometry) { return; }
+
+    // clip to tile to drop buffer, only if sticking out
+    const auto rectangle(tileRectangle(tileId_, stitchExtent));
+    ::OGREnvelope ge, te;
+    geometry->getEnvelope(&ge);
+    rectangle->getEnvelope(&te);
+    if (!te.Contains(ge)) {
+        if (auto *clipped = geometry->Intersection(rectangle.get())) {
+            geometry.reset(clipped);
+        }
+        if (geometry->IsEmpty()) { return; }
+    }
 
-    if (isMbTilesArchive(openInfo)) { return true; }
+    // grouping key
+    std::string key;
+    if (keyField_ >= 0) {
+        if (feature->IsFieldSetAndNotNull(keyField_)) {
+            key = feature->GetFieldAsString(keyField_);
+        }
+    } else if (feature->GetFID() != OGRNullFID) {
+        key = std::to_string(feature->GetFID());
+    }
 
-    // TODO: try to decode
+    if (key.empty()) {
+        // cannot be stitched, pass through
+        Fragments fragments;
+        fragments.feature = std::move(feature);
+        fragments.geometries.push_back(std::move(geometry));
+        ready_.push_back(finish(fragments));
+        return;
+    }
 
-    // let the rest of machinery decode
-    return true;
+    // feature already emitted (e.g. concave feature missing in whole row):
+    // it cannot be merged anymore, late fragments form new feature
+    auto iemitted(emitted_.find(key));
+    if (iemitted != emitted_.end()) {
+        LOG(info1) << "Feature <" << key << "> re-appears in tile "
+                   << ds_.config_.zoom << "-" << tileId_.x << "-"
+                   << tileId_.y << " after it has been stitched; emitting "
+                   "late fragments as separate feature.";
+        emitted_.erase(iemitted);
+    }
+
+    auto &fragments(pending_[key]);
+    if (!fragments.feature) {
+        fragments.feature = std::move(feature);
+        fragments.order = order_++;
+    }
+    fragments.geometries.push_back(std::move(geometry));
+    fragments.lastRow = tileId_.y;
 }
 
-bool loadFromRemote(vector_tile::Tile &tile, const char *path)
+void MvtMosaicDataset::Layer::flush(int row)
 {
-    ::CPLErrorReset();
-    struct Result {
-        Result(::CPLHTTPResult *res) : res(res) {}
-        ~Result() { if (res) { ::CPLHTTPDestroyResult(res); } }
-        ::CPLHTTPResult *res;
-    } res(::CPLHTTPFetch(path, nullptr));
+    // collect complete groups in order of first appearance
+    std::vector<std::pair<std::size_t, std::string>> done;
+    for (const auto &item : pending_) {
+        if (item.second.lastRow < row) {
+            done.emplace_back(item.second.order, item.first);
+        }
+    }
+    std::sort(done.begin(), done.end());
 
-    if (!res.res || !res.res->nDataLen || ::CPLGetLastErrorNo()) {
-        return false;
+    for (const auto &item : done) {
+        auto ipending(pending_.find(item.second));
+        emitted_[item.second] = ipending->second.lastRow;
+        try {
+            ready_.push_back(finish(ipending->second));
+        } catch (const std::exception &e) {
+            CPLError(CE_Warning, CPLE_AppDefined
+                     , "Unable to stitch feature <%s>: %s."
+                     , item.second.c_str(), e.what());
+        }
+        pending_.erase(ipending);
     }
 
-    switch (res.res->nStatus) {
-    case 0: break;
+    // remember emitted keys only for two more rows to keep memory bound to
+    // the active rows
+    for (auto iemitted(emitted_.begin()); iemitted != emitted_.end(); ) {
+        if (iemitted->second < row - 2) {
+            iemitted = emitted_.erase(iemitted);
+        } else {
+            ++iemitted;
+        }
+    }
+}
 
-    case 404:
-        CPLError(CE_Failure, CPLE_OpenFailed,
-                 "Curl reports error: %d: %s",
-                 res.res->nStatus, res.res->pszErrBuf);
-        return false;
+std::unique_ptr< ::OGRFeature>
+MvtMosaicDataset::Layer::finish(Fragments &fragments)
+{
+    auto geometry(mergeGeometries(fragments.geometries));
+
+    // integer space of the zoom level to world
+    transformGeometry(*geometry
+                      , Trafo(stitchExtent * (1u << ds_.config_.zoom)
+                              , ds_.config_.extents)
+                      , coords_);
+    if (ds_.srs_) { geometry->assignSpatialReference(ds_.srs_.get()); }
+
+    auto feature(std::move(fragments.feature));
+    feature->SetGeometryDirectly(geometry.release());
+    return feature;
+}
 
-    default:
-        CPLError(CE_Failure, CPLE_AppDefined,
-                 "Curl reports error: %d: %s",
-                 res.res->nStatus, res.res->pszErrBuf);
-        return false;
+MvtMosaicDataset::MvtMosaicDataset(const std::shared_ptr<TileSource> &source
+                                   , const Config &config)
+    : source_(source), config_(config)
+{
+    if (config_.srs) {
+        srs_ = std::make_shared< ::OGRSpatialReference>
+            (config_.srs->reference());
     }
+}
+
+MvtMosaicDataset::~MvtMosaicDataset() {}
 
-    // try to parse
-    return tile.ParseFromArray(res.res->pabyData, res.res->nDataLen);
+OGRLayer* MvtMosaicDataset::GetLayer(int l)
+{
+    if ((l < 0) || (l >= int(layers_.size()))) { return nullptr; }
+    return layers_[l].get();
 }
 
-GDALDataset* MvtDataset::Open(::GDALOpenInfo *openInfo)
+OGRLayer* MvtMosaicDataset::GetLayerByName(const char *name)
 {
-    ::CPLErrorReset();
+    for (const auto &layer : layers_) {
+        if (EQUAL(layer->GetName(), name)) { return layer.get(); }
+    }
+    return nullptr;
+}
 
-    // TODO: detect
+bool MvtMosaicDataset::declare(const std::string &json)
+{
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(json, root) || !root.isObject()) { return false; }
 
-    // open
-    std::unique_ptr<vector_tile::Tile> tile(new vector_tile::Tile());
+    const auto &vectorLayers(root["vector_layers"]);
+    if (!vectorLayers.isArray() || vectorLayers.empty()) { return false; }
 
-    const auto &loadLocal([&](const char *path) -> bool
-    {
-        std::ifstream f(path, std::ios::in | std::ios::binary);
-        return tile->ParseFromIstream(&f);
-    });
+    for (const auto &vectorLayer : vectorLayers) {
+        if (!vectorLayer.isObject() || !vectorLayer["id"].isString()) {
+            return false;
+        }
+    }
 
-    try {
-        if (auto mvtPath = isMvtPath(openInfo)) {
-            if (isRemotePath(mvtPath)) {
-                if (!loadFromRemote(*tile, mvtPath)) { return nullptr; }
-            } else if (!loadLocal(mvtPath)) {
-                return nullptr;
+    for (const auto &vectorLayer : vectorLayers) {
+        auto *featureDefn(::OGRFeatureDefn::CreateFeatureDefn
+                          (vectorLayer["id"].asString().c_str()));
+        layers_.emplace_back(new Layer(*this, featureDefn));
+
+        const auto &fields(vectorLayer["fields"]);
+        if (config_.noFields || !fields.isObject()) { continue; }
+
+        for (const auto &name : fields.getMemberNames()) {
+            const auto &type(fields[name]);
+            const auto typeName(type.isString() ? type.asString() : "");
+
+            if (typeName == "Number") {
+                ::OGRFieldDefn def(name.c_str(), ::OGRFieldType::OFTReal);
+                featureDefn->AddFieldDefn(&def);
+            } else if (typeName == "Boolean") {
+                ::OGRFieldDefn def(name.c_str(), ::OGRFieldType::OFTInteger);
+                def.SetSubType(::OGRFieldSubType::OFSTBoolean);
+                featureDefn->AddFieldDefn(&def);
+            } else {
+                ::OGRFieldDefn def(name.c_str(), ::OGRFieldType::OFTString);
+                featureDefn->AddFieldDefn(&def);
             }
-        } else if (isRemoteMvt(openInfo)) {
-            if (!loadFromRemote(*tile, openInfo->pszFilename)) {
-                return nullptr;
+        }
+    }
+
+    return true;
+}
+
+bool MvtMosaicDataset::discover(bool keepTiles)
+{
+    /** Schema of one layer, keys in order of first appearance.
+     */
+    struct Schema {
+        std::string name;
+        std::vector<std::string> keys;
+        std::map<std::string, FieldType> types;
+    };
+
+    std::vector<Schema> schemas;
+    std::map<std::string, std::size_t> index;
+    std::size_t loadedCount(0);
+
+    auto decoded(std::make_shared<DecodedTiles>());
+
+    auto prefetcher(prefetchTiles(source_, config_, config_.tiles, {}
+                                  , config_.discovery));
+    LoadedTile loaded;
+    while (prefetcher->next(loaded)) {
+        if (!loaded.tile) { continue; }
+        ++loadedCount;
+
+        if (keepTiles) {
+            decoded->emplace(std::make_pair(loaded.id.x, loaded.id.y)
+                             , loaded.tile);
+        }
+
+        for (const auto &layer : loaded.tile->layers()) {
+            const auto res(index.emplace(layer.name(), schemas.size()));
+            if (res.second) {
+                schemas.emplace_back();
+                schemas.back().name = layer.name();
             }
-        } else if (isMbTilesArchive(openInfo)) {
-            if (!detail::loadFromMbTilesArchive
-                (*tile, openInfo->pszFilename))
-            {
-                return nullptr;
+            auto &schema(schemas[res.first->second]);
+
+            if (config_.noFields) { continue; }
+
+            // merge this tile's types into layer schema
+            const auto types(fieldTypes(layer));
+            for (int k(0), ke(types.size()); k < ke; ++k) {
+                if (!types[k].used) { continue; }
+
+                const auto &key(layer.keys(k));
+                auto ftypes(schema.types.emplace(key, FieldType()));
+                if (ftypes.second) { schema.keys.push_back(key); }
+                ftypes.first->second.update(types[k]);
             }
-        } else if (!loadLocal(openInfo->pszFilename)) {
-            return nullptr;
         }
-    } catch (...) {
+    }
+
+    if (!loadedCount) {
+        CPLError(CE_Failure, CPLE_OpenFailed
+                 , "MVT mosaic initialization failure: "
+                 "no tile found in given tile range.");
+        return false;
+    }
+
+    if (!decoded->empty()) { decoded_ = decoded; }
+
+    for (const auto &schema : schemas) {
+        auto *featureDefn
+            (::OGRFeatureDefn::CreateFeatureDefn(schema.name.c_str()));
+
+        for (const auto &key : schema.keys) {
+            const auto &type(schema.types.at(key));
+            ::OGRFieldDefn def(key.c_str(), type.type);
+            def.SetSubType(type.subType);
+            featureDefn->AddFieldDefn(&def);
+        }
+
+        layers_.emplace_back(new Layer(*this, featureDefn));
+    }
+
+    return true;
+}
+
+::GDALDataset* MvtMosaicDataset::Open(::GDALOpenInfo *openInfo
+                                      , const char *source, bool archive)
+{
+    const auto options(openInfo->papszOpenOptions);
+    const bool mbtiles(ba::iends_with(source, ".mbtiles"));
+
+    // archive metadata are optional
+    std::map<std::string, std::string> metadata;
+    if (mbtiles) {
+        configureArchive(source, options);
+        ::CPLPushErrorHandler(::CPLQuietErrorHandler);
+        if (!detail::readMbTilesMetadata(source, metadata)) {
+            metadata.clear();
+        }
+        ::CPLPopErrorHandler();
+    }
+    const auto meta([&metadata](const char *name) -> const char*
+    {
+        auto fmetadata(metadata.find(name));
+        if (fmetadata == metadata.end()) { return nullptr; }
+        return fmetadata->second.c_str();
+    });
+
+    if (archive) {
+        // raster archive, leave it to other drivers
+        const char *format(meta("format"));
+        if (format && (std::strcmp(format, "pbf") != 0)) { return nullptr; }
+    }
+
+    Config config;
+    boost::optional<math::Extents2> extents;
+    if (!commonOptions(openInfo->papszOpenOptions, config.srs, extents
+                       , config.noFields))
+    {
         return nullptr;
     }
+    if (extents) {
+        config.extents = *extents;
+    } else if (archive) {
+        // MBTiles are always in spherical mercator
+        config.extents = webMercatorExtents();
+    }
 
-    if (openInfo->eAccess == GA_Update) {
-        CPLError(CE_Warning, CPLE_NotSupported,
-                 "MVT driver allows only read-only access.");
+    if (archive && !config.srs) {
+        config.srs = geo::SrsDefinition::fromString(webMercatorSrs);
     }
 
-    boost::optional<geo::SrsDefinition> srs;
+    const char *zoom(::CSLFetchNameValue(options, "MVT_MOSAIC_ZOOM"));
+    if (!zoom) { zoom = ::CSLFetchNameValue(options, "ZOOM_LEVEL"); }
+    if (!zoom) { zoom = meta("maxzoom"); }
+    if (!zoom) {
+        CPLError(CE_Failure, CPLE_IllegalArg
+                 , "MVT mosaic initialization failure: "
+                 "missing open option MVT_MOSAIC_ZOOM.");
+        return nullptr;
+    }
+
+    try {
+        config.zoom = boost::lexical_cast<unsigned int>(zoom);
+    } catch (const std::exception&) {
+        config.zoom = 31;
+    }
+    if (config.zoom > 30) {
+        CPLError(CE_Failure, CPLE_IllegalArg
+                 , "MVT mosaic initialization failure: "
+                 "invalid open option MVT_MOSAIC_ZOOM (%s).", zoom);
+        return nullptr;
+    }
 
-    if (const char *mvtSrs
-        = ::CSLFetchNameValue(openInfo->papszOpenOptions, "MVT_SRS"))
+    const int max((1 << config.zoom) - 1);
+    config.tiles = math::Extents2i(0, 0, max, max);
+
+    if (const char *tiles = ::CSLFetchNameValue(options, "MVT_MOSAIC_TILES"))
     {
+        math::Extents2i range;
         try {
-            srs = geo::SrsDefinition::fromString(mvtSrs);
-        } catch (const std::exception &e) {
+            range = boost::lexical_cast<math::Extents2i>(tiles);
+        } catch (const std::exception&) {
             CPLError(CE_Failure, CPLE_IllegalArg
-                     , "MVT Dataset initialization failure: "
-                     "failed to parse provided open options MVT_SRS (%s)."
-                     , e.what());
+                     , "MVT mosaic initialization failure: "
+                     "failed to parse provided open options "
+                     "MVT_MOSAIC_TILES.");
             return nullptr;
         }
+
+        // clip to zoom level
+        config.tiles = math::Extents2i
+            (std::max(range.ll(0), 0), std::max(range.ll(1), 0)
+             , std::min(range.ur(0), max), std::min(range.ur(1), max));
+    } else if (const char *bounds = meta("bounds")) {
+        // limit range to archive's bounds
+        if (auto range = boundsTileRange(bounds, config.zoom)) {
+            config.tiles = *range;
+        }
     }
 
-    boost::optional<math::Extents2> extents;
-    if (const char *mvtExtents
-        = ::CSLFetchNameValue(openInfo->papszOpenOptions, "MVT_EXTENTS"))
+    config.threads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (const char *threads
+        = ::CSLFetchNameValue(options, "MVT_MOSAIC_THREADS"))
     {
-        try {
-            extents = boost::lexical_cast<math::Extents2>(mvtExtents);
-        } catch (const std::exception&) {
+        config.threads = std::max(std::atoi(threads), 1);
+    }
+
+    config.lookahead = 2 * config.threads;
+    if (const char *lookahead
+        = ::CSLFetchNameValue(options, "MVT_MOSAIC_LOOKAHEAD"))
+    {
+        config.lookahead = std::max(std::atoi(lookahead), 1);
+    }
+
+    config.trusted = ::CSLFetchBoolean(options, "MVT_TRUSTED", false);
+    config.stitch = ::CSLFetchBoolean(options, "MVT_STITCH", false);
+    config.stitchKey = ::CSLFetchNameValueDef(options, "MVT_STITCH_KEY", "");
+
+    if (const char *discovery
+        = ::CSLFetchNameValue(options, "MVT_MOSAIC_DISCOVERY"))
+    {
+        config.discovery = std::max(std::atoi(discovery), 0);
+    }
+
+    TileSource::pointer tileSource;
+    if (mbtiles) {
+        tileSource = std::make_shared<MbTilesTileSource>(source);
+    } else if (TemplateTileSource::valid(source)) {
+        // every tile of the range is a request, never walk whole zoom level
+        // implicitly
+        if (!::CSLFetchNameValue(options, "MVT_MOSAIC_TILES")) {
             CPLError(CE_Failure, CPLE_IllegalArg
-                     , "MVT Dataset initialization failure: "
-                     "failed to parse provided open options MVT_EXTENTS.");
+                     , "MVT mosaic initialization failure: "
+                     "open option MVT_MOSAIC_TILES is mandatory for "
+                     "template <%s>.", source);
             return nullptr;
         }
+        tileSource = std::make_shared<TemplateTileSource>(source);
+    } else {
+        CPLError(CE_Failure, CPLE_IllegalArg
+                 , "MVT mosaic initialization failure: "
+                 "<%s> is neither template with {z}, {x} and {y} "
+                 "placeholders nor MBTiles archive.", source);
+        return nullptr;
+    }
+
+    if (openInfo->eAccess == GA_Update) {
+        CPLError(CE_Warning, CPLE_NotSupported,
+                 "MVT mosaic is read-only, "
+                 "single tiles are written via Create.");
     }
 
-    bool noFields
-        (::CSLFetchBoolean(openInfo->papszOpenOptions, "MVT_NOFIELDS", false));
+    std::unique_ptr<MvtMosaicDataset> ds
+        (new MvtMosaicDataset(tileSource, config));
 
-    // parsed tile, pass it to dataset
-    return new MvtDataset(std::move(tile), srs, extents, noFields);
+    // use declared layers if available, otherwise walk (some) tiles; fetched
+    // template tiles are kept to not fetch them twice
+    const char *json(meta("json"));
+    if (!(json && ds->declare(json)) && !ds->discover(!mbtiles)) {
+        return nullptr;
+    }
+    return ds.release();
 }
 
 } // namespace gdal_drivers
@@ -832,9 +4005,29 @@ void GDALRegister_MvtDataset()
     driver->SetMetadataItem
         (GDAL_DMD_LONGNAME, "Mapbox Vector Tiles.");
     driver->SetMetadataItem(GDAL_DMD_EXTENSION, "");
+    driver->SetMetadataItem(GDAL_DCAP_VIRTUALIO, "YES");
+
+    driver->SetMetadataItem(GDAL_DCAP_CREATE, "YES");
+    driver->SetMetadataItem
+        (GDAL_DMD_CREATIONOPTIONLIST,
+         "<CreationOptionList>"
+         "  <Option name='MVT_SRS' type='string' "
+         "description='SRS of the tile'/>"
+         "  <Option name='MVT_EXTENTS' type='string' "
+         "description='Tile extents (xmin,ymin:xmax,ymax)'/>"
+         "  <Option name='MVT_EXTENT' type='int' default='4096' "
+         "description='Default layer extent'/>"
+         "</CreationOptionList>");
+    driver->SetMetadataItem
+        (GDAL_DS_LAYER_CREATIONOPTIONLIST,
+         "<LayerCreationOptionList>"
+         "  <Option name='EXTENT' type='int' "
+         "description='Layer extent'/>"
+         "</LayerCreationOptionList>");
 
     driver->pfnOpen = gdal_drivers::MvtDataset::Open;
     driver->pfnIdentify = gdal_drivers::MvtDataset::Identify;
+    driver->pfnCreate = gdal_drivers::MvtDataset::Create;
 
     manager->RegisterDriver(driver.release());
 }
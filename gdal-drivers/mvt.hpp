@@ -37,7 +37,11 @@
 #include <memory>
 #include <array>
 #include <vector>
+#include <map>
+#include <utility>
+#include <string>
 
+#include <boost/optional.hpp>
 #include <boost/variant.hpp>
 #include <boost/filesystem/path.hpp>
 
@@ -58,24 +62,282 @@ public:
     static ::GDALDataset* Open(::GDALOpenInfo *openInfo);
     static int Identify(::GDALOpenInfo *openInfo);
 
+    /** Creates new tile. Tile is written to path (file or
+     *  "archive.mbtiles/zoom-col-row") when dataset is closed; write failure
+     *  is reported via CPLError. Existing tiles cannot be opened for update.
+     *
+     *  Creation options: MVT_SRS, MVT_EXTENTS (same as open options) and
+     *  MVT_EXTENT (default layer extent, 4096 by default).
+     */
+    static ::GDALDataset* Create(const char *path, int xSize, int ySize
+                                 , int bands, ::GDALDataType type
+                                 , char **options);
+
+    virtual ~MvtDataset();
+
     class Layer;
     friend class Layer;
 
-    virtual int GetLayerCount() override { return layers_.size(); }
+    class Writer;
+    friend class Writer;
+
+    virtual int GetLayerCount() override;
 
     virtual OGRLayer* GetLayer(int) override;
     virtual OGRLayer* GetLayerByName(const char *name) override;
 
+    virtual int TestCapability(const char *cap) override;
+
+#if GDAL_VERSION_NUM >= 3090000
+    virtual ::OGRLayer* ICreateLayer(const char *name
+                                     , const ::OGRGeomFieldDefn *geomField
+                                     , CSLConstList options) override;
+#else
+    virtual ::OGRLayer* ICreateLayer(const char *name
+                                     , ::OGRSpatialReference *srs
+                                     , ::OGRwkbGeometryType type
+                                     , char **options) override;
+#endif
+
+    /** Columnar representation of whole tile layer.
+     *
+     *  Feature i consists of parts [featureParts[i], featureParts[i + 1]),
+     *  part j consists of points [parts[j], parts[j + 1]) in x/y arrays.
+     *  Multi point is stored as a single part.
+     */
+    struct Columns {
+        /** Feature IDs, OGRNullFID if feature has no ID.
+         */
+        std::vector< ::GIntBig> fid;
+
+        /** Geometry type of each feature.
+         */
+        std::vector< ::OGRwkbGeometryType> type;
+
+        std::vector<std::size_t> featureParts;
+        std::vector<std::size_t> parts;
+
+        /** Exterior ring flag for each part (polygons only).
+         */
+        std::vector<bool> exterior;
+
+        std::vector<double> x;
+        std::vector<double> y;
+
+        /** Single attribute column. Only vector(s) matching type are used.
+         */
+        struct Column {
+            std::string name;
+            ::OGRFieldType type;
+
+            /** Non-zero if value is set.
+             */
+            std::vector<std::uint8_t> valid;
+
+            /** OFTInteger and OFTInteger64 values.
+             */
+            std::vector< ::GIntBig> integers;
+
+            /** OFTReal values.
+             */
+            std::vector<double> reals;
+
+            /** OFTString values: concatenated strings and n + 1 offsets.
+             */
+            std::string strings;
+            std::vector<std::size_t> offsets;
+
+            typedef std::vector<Column> list;
+        };
+
+        Column::list columns;
+    };
+
+    /** Decodes whole layer into columns in one go, bypassing per-feature OGR
+     *  objects. Attribute and spatial filters are not applied.
+     *
+     *  Returns false on failure (CPLError is set).
+     */
+    bool readColumns(int layer, Columns &columns);
+
 private:
-    MvtDataset(std::unique_ptr<vector_tile::Tile> tile
+    MvtDataset(const std::shared_ptr<const vector_tile::Tile> &tile
                , const boost::optional<geo::SrsDefinition> &srs
                , const boost::optional<math::Extents2> &extents
-               , bool noFields);
+               , bool noFields, bool raw
+               , const boost::optional<geo::SrsDefinition> &targetSrs);
 
-    std::unique_ptr<vector_tile::Tile> tile_;
+    /** Decoded tile, shared with other datasets via process-wide cache
+     *  (MVT_CACHE_SIZE configuration option).
+     */
+    std::shared_ptr<const vector_tile::Tile> tile_;
     boost::optional<geo::SrsDefinition> srs_;
     boost::optional<math::Extents2> extents_;
     bool noFields_;
+
+    /** Geometries are decoded without validation (MVT_TRUSTED). Use only for
+     *  tiles from known encoders: malformed input yields garbage geometry
+     *  instead of an error (but is never read out of bounds).
+     */
+    bool trusted_;
+
+    /** Geometries are left in tile integer space (MVT_RAW), world
+     *  transformation is published as layer metadata.
+     */
+    bool raw_;
+
+    /** Geometries are reprojected to this SRS (MVT_TARGET_SRS).
+     */
+    boost::optional<geo::SrsDefinition> targetSrs_;
+    std::shared_ptr< ::OGRCoordinateTransformation> ct_;
+
+    std::vector<std::unique_ptr<Layer>> layers_;
+
+    /** Output path, non-empty only for created datasets.
+     */
+    std::string output_;
+
+    /** Tile being built (same as tile_), only for created datasets.
+     */
+    std::shared_ptr<vector_tile::Tile> created_;
+
+    /** Default extent of created layers.
+     */
+    std::uint32_t extent_;
+
+    std::vector<std::unique_ptr<Writer>> writers_;
+
+    ::OGRLayer* createLayer(const char *name
+                            , const ::OGRSpatialReference *srs
+                            , char **options);
+
+    /** Serializes tile to output. Returns false on failure.
+     */
+    bool save();
+
+    /** Writes serialized tile to output. Returns false on failure.
+     */
+    bool write(const std::string &data);
+};
+
+/** Range of tiles at single zoom level exposed as one set of layers.
+ *
+ *  Opened via "mvt:mosaic:<source>" where source is either a path/URL
+ *  template with {z}, {x} and {y} placeholders or an MBTiles archive.
+ *
+ *  Layer schema is the union of schemata of discovered tiles (first
+ *  MVT_MOSAIC_DISCOVERY tiles of the range). Tiles fetched via template
+ *  during discovery are kept decoded and reused by reads. Tiles are loaded
+ *  and decoded in parallel ahead of the reader and features are returned in
+ *  tile order (row by row).
+ *
+ *  Open options:
+ *      MVT_MOSAIC_ZOOM       zoom level (mandatory)
+ *      MVT_MOSAIC_TILES      inclusive tile range xmin,ymin:xmax,ymax
+ *                            (mandatory for templates, whole zoom level
+ *                            or archive bounds for MBTiles by default)
+ *      MVT_MOSAIC_DISCOVERY  maximum number of tiles visited to discover
+ *                            layer schema (256 by default, 0 = all)
+ *      MVT_MOSAIC_THREADS    number of decoding threads
+ *      MVT_MOSAIC_LOOKAHEAD  maximum number of tiles held ahead of reader
+ *      MVT_EXTENTS           extents of root tile (0,0:1,1 by default)
+ *      MVT_STITCH            merge fragments of features split at tile
+ *                            edges into single features
+ *      MVT_STITCH_KEY        field identifying feature fragments
+ *                            (feature ID by default)
+ *      MVT_SRS, MVT_NOFIELDS, MVT_TRUSTED
+ *                            same as for single tile
+ *      SQLITE_IMMUTABLE, SQLITE_NOLOCK, SQLITE_MMAP_SIZE, SQLITE_CACHE_SIZE
+ *                            SQLite tuning of MBTiles archive (also for
+ *                            single tiles from archive)
+ *      TILE_INDEX, TILE_INDEX_FILE
+ *                            in-memory index of existing archive tiles,
+ *                            optionally persisted in given file; missing
+ *                            single tiles are rejected without query
+ *
+ *  Bare "archive.mbtiles" path opens whole archive as mosaic: zoom is given
+ *  by ZOOM_LEVEL (MBTiles metadata maxzoom by default), tile range by
+ *  metadata bounds and schema by metadata vector_layers (when present).
+ *  Spherical mercator SRS and extents are used unless MVT_SRS and
+ *  MVT_EXTENTS are given. Archive tiles are streamed by a single query.
+ *  Tiles of deduplicated archives (map/images schema) sharing one blob are
+ *  decoded once (MBTILES_SHARED_CACHE_SIZE configuration option).
+ *
+ *  Stitched fragments are clipped to their tiles (dropping tile buffers) and
+ *  merged in integer space of the zoom level, so that shared edges match
+ *  exactly. Feature is complete once reading moves two rows past the last
+ *  row it was seen in, so only features touching the last few tile rows are
+ *  held in memory. Fragments of a feature re-appearing after it has been
+ *  completed (e.g. concave feature skipping whole row) are emitted as
+ *  separate feature. Spatial filter is applied to stitched features, so all
+ *  tiles in the range are read.
+ */
+class MvtMosaicDataset : public GDALDataset {
+public:
+    struct Config {
+        unsigned int zoom;
+        math::Extents2i tiles;
+        math::Extents2 extents;
+        boost::optional<geo::SrsDefinition> srs;
+        bool noFields;
+        unsigned int threads;
+        unsigned int lookahead;
+        bool trusted;
+        bool stitch;
+        std::string stitchKey;
+        std::size_t discovery;
+
+        Config() : zoom(), extents(0.0, 0.0, 1.0, 1.0), noFields(false)
+                 , threads(1), lookahead(2), trusted(false), stitch(false)
+                 , discovery(256)
+        {}
+    };
+
+    /** Decoded tiles indexed by (x, y).
+     */
+    typedef std::map<std::pair<int, int>
+                     , std::shared_ptr<const vector_tile::Tile>> DecodedTiles;
+
+    /** Opens mosaic, source is the part of path after "mvt:mosaic:" or
+     *  whole MBTiles archive (archive is set).
+     */
+    static ::GDALDataset* Open(::GDALOpenInfo *openInfo, const char *source
+                               , bool archive = false);
+
+    virtual ~MvtMosaicDataset();
+
+    class Layer;
+    friend class Layer;
+
+    class TileSource;
+
+    virtual int GetLayerCount() override { return layers_.size(); }
+
+    virtual OGRLayer* GetLayer(int) override;
+    virtual OGRLayer* GetLayerByName(const char *name) override;
+
+private:
+    MvtMosaicDataset(const std::shared_ptr<TileSource> &source
+                     , const Config &config);
+
+    /** Builds layers from MBTiles metadata (vector_layers). Returns false if
+     *  there is nothing usable.
+     */
+    bool declare(const std::string &json);
+
+    /** Walks tiles (up to config's discovery limit) and builds layers. Walked
+     *  tiles are kept for reading if keepTiles is set. Returns false on
+     *  failure.
+     */
+    bool discover(bool keepTiles);
+
+    std::shared_ptr<TileSource> source_;
+    Config config_;
+
+    /** Tiles decoded during discovery, reused by layers.
+     */
+    std::shared_ptr<const DecodedTiles> decoded_;
+    std::shared_ptr< ::OGRSpatialReference> srs_;
     std::vector<std::unique_ptr<Layer>> layers_;
 };
 
@@ -32,6 +32,10 @@
 #  include "./mvt.hpp"
 #endif
 
+#ifdef GDAL_DRIVERS_HAS_SQLITE3
+#  include "./mbtilesraster.hpp"
+#endif
+
 namespace gdal_drivers {
 
 void registerAll()
@@ -44,6 +48,10 @@ void registerAll()
 #ifdef GDAL_DRIVERS_HAS_PROTOBUF
     GDALRegister_MvtDataset();
 #endif
+
+#ifdef GDAL_DRIVERS_HAS_SQLITE3
+    GDALRegister_MbTilesRasterDataset();
+#endif
 }
 
 } // namespace gdal_drivers
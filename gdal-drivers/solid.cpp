@@ -28,6 +28,7 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <vector>
 #include <iterator>
@@ -43,6 +44,7 @@
 #include "geo/po.hpp"
 
 #include "detail/geotransform.hpp"
+#include "detail/overviews.hpp"
 
 #include "solid.hpp"
 
@@ -92,28 +94,49 @@ void writeConfig(const boost::filesystem::path &file
  */
 class SolidDataset::RasterBand : public ::GDALRasterBand {
 public:
-    RasterBand(SolidDataset *dset, const Config::Band &band
+    RasterBand(SolidDataset *dset, int index, const Config::Band &band
                , const std::vector<math::Size2> &overviews);
 
-    virtual ~RasterBand() {
-        for (auto &ovr : ovrBands_) { delete ovr; }
-    }
+    virtual ~RasterBand() {}
 
     virtual CPLErr IReadBlock(int blockCol, int blockRow, void *image);
 
+    /** Fills caller's buffer directly, block cache is not involved.
+     */
+    virtual CPLErr IRasterIO(::GDALRWFlag flag, int, int, int, int
+                             , void *data, int bufXSize, int bufYSize
+                             , ::GDALDataType bufType
+                             , ::GSpacing pixelSpace, ::GSpacing lineSpace
+                             , ::GDALRasterIOExtraArg*)
+    {
+        return fill(flag, data, bufXSize, bufYSize, bufType
+                    , pixelSpace, lineSpace);
+    }
+
+    virtual int IGetDataCoverageStatus(int, int, int, int, int
+                                       , double *dataPct)
+    {
+        return coverage(dataPct);
+    }
+
+    virtual double GetMinimum(int *success = nullptr) {
+        if (success) { *success = true; }
+        return value_;
+    }
+
+    virtual double GetMaximum(int *success = nullptr) {
+        if (success) { *success = true; }
+        return value_;
+    }
+
     virtual GDALColorInterp GetColorInterpretation() {
         return colorInterpretation_;
     }
 
-    virtual int GetOverviewCount() { return overviews_.size(); }
+    virtual int GetOverviewCount() { return overviews_.count(); }
 
     virtual GDALRasterBand* GetOverview(int index) {
-        if (index >= int(ovrBands_.size())) { return nullptr; }
-        auto &ovr(ovrBands_[index]);
-        if (!ovr) {
-            ovr = new OvrBand(this, overviews_[index]);
-        }
-        return ovr;
+        return overviews_.get(index);
     }
 
 private:
@@ -136,6 +159,31 @@ private:
             return owner_->IReadBlock(blockCol, blockRow, image);
         }
 
+        virtual CPLErr IRasterIO(::GDALRWFlag flag, int, int, int, int
+                                 , void *data, int bufXSize, int bufYSize
+                                 , ::GDALDataType bufType
+                                 , ::GSpacing pixelSpace
+                                 , ::GSpacing lineSpace
+                                 , ::GDALRasterIOExtraArg*)
+        {
+            return owner_->fill(flag, data, bufXSize, bufYSize, bufType
+                                , pixelSpace, lineSpace);
+        }
+
+        virtual int IGetDataCoverageStatus(int, int, int, int, int
+                                           , double *dataPct)
+        {
+            return owner_->coverage(dataPct);
+        }
+
+        virtual double GetMinimum(int *success = nullptr) {
+            return owner_->GetMinimum(success);
+        }
+
+        virtual double GetMaximum(int *success = nullptr) {
+            return owner_->GetMaximum(success);
+        }
+
         virtual GDALColorInterp GetColorInterpretation() {
             return owner_->GetColorInterpretation();
         }
@@ -146,18 +194,27 @@ private:
 
     friend class OvrBand;
 
-    template <typename T>
-    void createBlock(const T &value, std::size_t count)
-    {
-        auto *block(new T[count]);
-        std::fill_n(block, count, value);
-        block_ = std::shared_ptr<T>(block, [](T *block) { delete [] block; });
-        blockSize_ = count * sizeof(T);
+    /** Broadcasts band value into raster I/O buffer.
+     */
+    CPLErr fill(::GDALRWFlag flag, void *data, int bufXSize, int bufYSize
+                , ::GDALDataType bufType, ::GSpacing pixelSpace
+                , ::GSpacing lineSpace) const;
+
+    /** Whole band is (constant) data.
+     */
+    int coverage(double *dataPct) const {
+        if (dataPct) { *dataPct = 100.0; }
+        return GDAL_DATA_COVERAGE_STATUS_DATA;
     }
 
-    /** Block of pregenerated data.
+    /** Band value.
      */
-    std::shared_ptr<void> block_;
+    double value_;
+
+    /** Block of pregenerated data, shared with other bands and with all
+     *  overview levels (they have the same block size).
+     */
+    std::shared_ptr<const void> block_;
 
     /** Size of block of pregenerated data in bytes.
      */
@@ -165,8 +222,7 @@ private:
 
     ::GDALColorInterp colorInterpretation_;
 
-    std::vector<math::Size2> overviews_;
-    std::vector< ::GDALRasterBand*> ovrBands_;
+    detail::OverviewBands overviews_;
 };
 
 GDALDataset* SolidDataset::Open(GDALOpenInfo *openInfo)
@@ -331,6 +387,9 @@ SolidDataset::SolidDataset(const Config &config)
     : SrsHoldingDataset(config.srs)
     , config_(config)
 {
+    nRasterXSize = config_.size.width;
+    nRasterYSize = config_.size.height;
+
     if (const auto *extents = config_.extents()) {
         const auto &e(*extents);
         auto es(math::size(e));
@@ -346,32 +405,15 @@ SolidDataset::SolidDataset(const Config &config)
         geoTransform_ = *geoTransform;
     }
 
-    nRasterXSize = config_.size.width;
-    nRasterYSize = config_.size.height;
-
-    // prepare overviews
-    std::vector<math::Size2> overviews;
-    {
-        auto size(config_.size);
-        auto halve([&]()
-        {
-            size.width = int(std::round(size.width / 2.0));
-            size.height = int(std::round(size.height / 2.0));
-        });
-
-        halve();
-        while ((size.width >= config_.tileSize.width)
-               || (size.height >= config_.tileSize.height))
-        {
-            overviews.push_back(size);
-            halve();
-        }
-    }
+    // overview levels sized as GDAL expects them
+    const auto overviews(detail::overviewSizes(config_.size
+                                               , config_.tileSize));
 
     // NB: bands are 1-based, start with zero, pre-increment before setting band
     int i(0);
     for (const auto &band : config_.bands) {
-        SetBand(++i, new RasterBand(this, band, overviews));
+        ++i;
+        SetBand(i, new RasterBand(this, i, band, overviews));
     }
 
 }
@@ -386,16 +428,14 @@ CPLErr SolidDataset::GetGeoTransform(double *padfTransform)
 }
 
 SolidDataset::RasterBand
-::RasterBand(SolidDataset *dset , const Config::Band &band
+::RasterBand(SolidDataset *dset, int index, const Config::Band &band
              , const std::vector<math::Size2> &overviews)
-    : block_(), blockSize_()
+    : value_(band.value), block_(), blockSize_()
     , colorInterpretation_(band.colorInterpretation)
-    , overviews_(overviews)
-    , ovrBands_(overviews.size(), nullptr)
 {
     const auto &cfg(dset->config_);
     poDS = dset;
-    nBand = 1;
+    nBand = index;
     nBlockXSize = cfg.tileSize.width;
     nBlockYSize = cfg.tileSize.height;
     eDataType = band.dataType;
@@ -403,41 +443,15 @@ SolidDataset::RasterBand
     nRasterXSize = cfg.size.width;
     nRasterYSize = cfg.size.height;
 
-    auto count(math::area(cfg.tileSize));
-
-    switch (eDataType) {
-    case ::GDT_Byte:
-        createBlock<std::uint8_t>(band.value, count);
-        break;
-
-    case ::GDT_UInt16:
-        createBlock<std::uint16_t>(band.value, count);
-        break;
-
-    case ::GDT_Int16:
-        createBlock<std::int16_t>(band.value, count);
-        break;
-
-    case ::GDT_UInt32:
-        createBlock<std::uint32_t>(band.value, count);
-        break;
+    const auto count(math::area(cfg.tileSize));
+    block_ = detail::constantBlock(eDataType, band.value, count);
+    blockSize_ = count * ::GDALGetDataTypeSizeBytes(eDataType);
 
-    case ::GDT_Int32:
-        createBlock<std::int32_t>(band.value, count);
-        break;
-
-    case ::GDT_Float32:
-        createBlock<float>(band.value, count);
-        break;
-
-    case ::GDT_Float64:
-        createBlock<double>(band.value, count);
-        break;
-
-    default:
-        utility::raise<std::runtime_error>
-            ("Unsupported data type <%s>.", eDataType);
-    };
+    // overviews share block with this band, created upfront
+    for (const auto &size : overviews) {
+        overviews_.add(std::unique_ptr< ::GDALRasterBand>
+                       (new OvrBand(this, size)));
+    }
 }
 
 CPLErr SolidDataset::RasterBand::IReadBlock(int, int, void *rawImage)
@@ -447,6 +461,33 @@ CPLErr SolidDataset::RasterBand::IReadBlock(int, int, void *rawImage)
     return CE_None;
 }
 
+CPLErr SolidDataset::RasterBand::fill(::GDALRWFlag flag, void *data
+                                      , int bufXSize, int bufYSize
+                                      , ::GDALDataType bufType
+                                      , ::GSpacing pixelSpace
+                                      , ::GSpacing lineSpace) const
+{
+    if (flag != GF_Read) {
+        CPLError(CE_Failure, CPLE_NotSupported
+                 , "Solid dataset is read-only.\n");
+        return CE_Failure;
+    }
+
+    // value already converted to band data type (first pixel of the block)
+    // converted to buffer type; complex types need 16 bytes
+    double word[2];
+    ::GDALCopyWords(block_.get(), eDataType, 0, word, bufType, 0, 1);
+
+    // broadcast value line by line (GDAL replicates single word fast)
+    auto *line(static_cast<GByte*>(data));
+    for (int j(0); j < bufYSize; ++j, line += lineSpace) {
+        ::GDALCopyWords(word, bufType, 0, line, bufType, int(pixelSpace)
+                        , bufXSize);
+    }
+
+    return CE_None;
+}
+
 const math::Extents2* SolidDataset::Config::extents() const
 {
     return detail::extents(extentsOrGeoTransform_);